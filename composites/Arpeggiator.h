@@ -4,7 +4,9 @@
 #include <cmath>
 
 #include "ArpegPlayer.h"
+#include "ArpegProgram.h"
 #include "ArpegRhythmPlayer.h"
+#include "AtomicRingBuffer.h"
 #include "GateDelay.h"
 #include "NoteBuffer.h"
 #include "SeqClock.h"
@@ -28,6 +30,7 @@ public:
     Arpeggiator() : TBase() {
         init();
     }
+    ~Arpeggiator();
 
     enum ParamIds {
         MODE_PARAM,
@@ -35,10 +38,13 @@ public:
         BEATS_PARAM,   // how we play the pattern back
         HOLD_PARAM,
         SCHEMA_PARAM,
-        POLY_PARAM,  // not used yet?
+        POLY_PARAM,  // input channels per arpeggiator. 0 means they all go to one
         RESET_MODE_PARAM,
-        GATE_DELAY_PARAM,
+        GATE_DELAY_PARAM,    // a GateDelay::Mode
         GATE_CLOCKED_PARAM,  // if true, gate only changes on clock rising edge.
+        CAPTURE_PARAM,       // ms to wait for the rest of a chord after a gate changes. 0 is one sample
+        SEED_PARAM,          // shuffle plays the same orders for the same seed
+        NO_REPEAT_PARAM,     // if true, a new shuffle won't start on the note the last one ended on
         NUM_PARAMS
     };
     enum InputIds {
@@ -77,144 +83,331 @@ public:
         return ArpegPlayer::shortModes();
     }
 
+    static const int maxArps = 16;
+
+    /**
+     * How many independent arpeggiators are running. Arpeggiator n plays
+     * on output channel n.
+     */
+    int getNumArps() const { return numArps; }
+
+    const NoteBuffer& getNoteBuffer(int arp) const {
+        assert(arp >= 0 && arp < maxArps);
+        return voices[arp].noteBuffer;
+    }
+
+    /**
+     * Play a pattern like "1 3 2 4 +oct 1" instead of the mode, see ArpegProgram.
+     * Empty text goes back to the mode.
+     * Call from the UI thread. The pattern is compiled here, and picked up
+     * by the audio thread on the next sample.
+     * @returns false if the text doesn't compile, and error says why.
+     */
+    bool setPattern(const std::string& text, std::string& error);
+    const std::string& getPattern() const { return patternText; }
+
 private:
     void init();
-    void onGateChange(int channel, bool gate);
 
     /**
+     * @param gates is the new gate for every channel, bit n is channel n.
+     * Changes are held until the capture window closes, then all go in at once.
+     */
+    void processGates(unsigned gates);
+
+    /**
+     * Puts all the gate changes since the last commit into the note buffers,
+     * one change per note buffer. CV is sampled now, so it has had the whole
+     * capture window to settle.
+     */
+    void commitGates();
+
+    /**
+     * @param arp is which arpeggiator the clock is for.
      * @param clockFired is true when detector decides a clock is rea.
      * @param clockValue is cleaned up clock input
      */
-    void onClockChange(bool clockFired, bool clockValue);
+    void onClockChange(int arp, bool clockFired, bool clockValue);
+    void processClock(int arp, SeqClock::ClockResults, bool clockValue);
 
-    bool lastGate[16]{0};
+    int arpForChannel(int channel) const {
+        return channelsPerArp ? channel / channelsPerArp : 0;
+    }
+    void setChannelsPerArp(int);
+
+    unsigned lastGates = 0;  // bit n is channel n. What the note buffers have
+    unsigned currentGates = 0;      // what the gate inputs have now
+    unsigned gatesWentOff = 0;      // channels that went low since the last commit
+    int captureCountdown = -1;      // samples until commit, -1 if nothing waiting
+    int captureSamples = 0;
+    float captureMs = 0;
+    float sampleRate = 0;
     bool allGatesLow = true;
     // float sampledPitch[16]{0};
-    bool lastClock{false};
     void processParams();
+    void processPrograms();
+
+    /**
+     * Everything one arpeggiator needs to play its notes.
+     * Only touched when a note comes or goes, or on a clock.
+     *
+     * Kept as one object per arp rather than split into arrays: the players
+     * point at their own note buffer, and none of this is read every sample.
+     */
+    class ArpVoice {
+    public:
+        NoteBuffer noteBuffer{32};
+        ArpegPlayer hiddenPlayer{&noteBuffer};
+        ArpegRhythmPlayer outerPlayer{&hiddenPlayer};
+    };
 
-    NoteBuffer noteBuffer{32};
-    ArpegPlayer hiddenPlayer{&noteBuffer};
-    ArpegRhythmPlayer outerPlayer{&hiddenPlayer};
-    SeqClock clock;
+    // The state looked at every sample is kept in arrays of its own, away from the voices.
+    // With a mono clock only clocks[0] is used.
+    SeqClock clocks[maxArps];
+    bool lastClock[maxArps] = {false};
+    int numArps = 1;
+    int channelsPerArp = 0;
+
+    ArpVoice voices[maxArps];
     GateDelay gateDelay;
     GateTrigger triggerInputProc;
 
+    // Patterns are compiled on the UI thread and come in here. The ones we are done
+    // with go back out, so the UI thread can delete them. nullptr means use the mode.
+    AtomicRingBuffer<ArpegProgram*, 4> programsIn;
+    AtomicRingBuffer<ArpegProgram*, 4> programsOut;
+    ArpegProgram* program = nullptr;  // the one playing
+    std::string patternText;          // UI thread only
+
     const int numModes = {int(modes().size())};
 };
 
 template <class TBase>
 inline void Arpeggiator<TBase>::init() {
-    clock.setResetMode(true);
+    for (auto& clock : clocks) {
+        clock.setResetMode(true);
+    }
     // TODO: need to setup clock also.
 }
 
+template <class TBase>
+inline Arpeggiator<TBase>::~Arpeggiator() {
+    delete program;
+    while (!programsIn.empty()) {
+        delete programsIn.pop();
+    }
+    while (!programsOut.empty()) {
+        delete programsOut.pop();
+    }
+}
+
+template <class TBase>
+inline bool Arpeggiator<TBase>::setPattern(const std::string& text, std::string& error) {
+    while (!programsOut.empty()) {
+        delete programsOut.pop();
+    }
+
+    ArpegProgram* newProgram = nullptr;
+    const bool blank = text.find_first_not_of(" \t\r\n") == std::string::npos;
+    if (!blank) {
+        newProgram = ArpegProgram::compile(text, error);
+        if (!newProgram) {
+            return false;
+        }
+    }
+    if (programsIn.full()) {
+        delete newProgram;
+        error = "busy, try again";
+        return false;
+    }
+    programsIn.push(newProgram);
+    patternText = blank ? std::string() : text;
+    return true;
+}
+
+template <class TBase>
+inline void Arpeggiator<TBase>::processPrograms() {
+    if (programsIn.empty() || programsOut.full()) {
+        return;
+    }
+    if (program) {
+        programsOut.push(program);
+    }
+    program = programsIn.pop();
+    for (auto& voice : voices) {
+        voice.hiddenPlayer.setProgram(program);
+    }
+}
+
+template <class TBase>
+inline void Arpeggiator<TBase>::setChannelsPerArp(int channels) {
+    if (channels == channelsPerArp) {
+        return;
+    }
+    // Empty all the arps, then every gate that is high goes in to its new arp
+    // on the next commit. Going through commitGates would leave held notes behind.
+    for (auto& voice : voices) {
+        voice.noteBuffer.clear();
+    }
+    lastGates = 0;
+    gatesWentOff = 0;
+    captureCountdown = captureSamples;
+    channelsPerArp = channels;
+}
+
 template <class TBase>
 inline void Arpeggiator<TBase>::process(const typename TBase::ProcessArgs& args) {
     // SQINFO("~process (enter)");
+    processPrograms();
     processParams();
+    if (args.sampleRate != sampleRate) {
+        sampleRate = args.sampleRate;
+        gateDelay.setSampleRate(sampleRate);
+        captureMs = -1;  // force it to re-calculate
+    }
+    const float ms = TBase::params[CAPTURE_PARAM].value;
+    if (ms != captureMs) {
+        captureMs = ms;
+        captureSamples = std::max(0, int(std::round(ms * sampleRate / 1000.f)));
+    }
+
     const int gates = TBase::inputs[GATE_INPUT].channels;
     const int cvs = TBase::inputs[CV_INPUT].channels;
     const bool monoGates = (gates == 1) && (cvs > 1);
 
    // SQINFO("gates = %d, connected = %d", gates, TBase::inputs[GATE_INPUT].isConnected());
 
-    int highestGateProcessed = 0;
+    gateDelay.process(TBase::inputs[GATE_INPUT], gates, &TBase::inputs[CV_INPUT], cvs);
     if (monoGates) {
-        highestGateProcessed = cvs;
         // for mono gates, just look at gate[0], but send to to all cv channels
         // SQDEBUG("gate delay will process mg input=%f", TBase::inputs[GATE_INPUT].getVoltage(0));
-        gateDelay.process(TBase::inputs[GATE_INPUT], gates);
-        const bool gate = gateDelay.getGate(0);
-        if (gate != lastGate[0]) {
-            lastGate[0] = gate;
-            for (int ch = 0; ch < cvs; ++ch) {
-                onGateChange(ch, gate);
-            }
-        }
+        processGates(gateDelay.getGate(0) ? SchmidtTriggerBank::channelMask(cvs) : 0);
     } else {
-        highestGateProcessed = gates;
-        gateDelay.process(TBase::inputs[GATE_INPUT], gates);
-        for (int ch = 0; ch < gates; ++ch) {
-            const bool gate = gateDelay.getGate(ch);
-            if (gate != lastGate[ch]) {
-                lastGate[ch] = gate;
-                onGateChange(ch, gate);
-            }
-        }
-    }
-
-    // optimization: could do this only if connected changes
-    for (int ch= highestGateProcessed; ch<16; ++ch) {
-        if (lastGate[ch]) {
-            lastGate[ch] = false;
-            onGateChange(ch, false);
-        }
+        // channels past the last gate are off
+        processGates(gateDelay.getGates() & SchmidtTriggerBank::channelMask(gates));
     }
 
     const bool shuffleInputConnected = TBase::inputs[SHUFFLE_TRIGGER_INPUT].isConnected();
+    bool armReShuffle = true;  // if no CV, we want it armed "all the time"
     if (shuffleInputConnected) {
         triggerInputProc.go(TBase::inputs[SHUFFLE_TRIGGER_INPUT].getVoltage(0));
-        if (triggerInputProc.trigger()) {
-            outerPlayer.armReShuffle();
+        armReShuffle = triggerInputProc.trigger();
+    }
+    if (armReShuffle) {
+        for (int arp = 0; arp < numArps; ++arp) {
+            voices[arp].outerPlayer.armReShuffle();
         }
-    } else {
-        // if no CV, we want it armed "all the time"
-        outerPlayer.armReShuffle();
     }
 
-    const float clockVoltageX = TBase::inputs[CLOCK_INPUT].getVoltage(0);
-    const float resetVoltage = TBase::inputs[RESET_INPUT].getVoltage(0);
-    auto clockResults = clock.updateOnce(clockVoltageX, true, resetVoltage);
+    TBase::outputs[CV_OUTPUT].setChannels(numArps);
+    TBase::outputs[CV2_OUTPUT].setChannels(numArps);
+    TBase::outputs[GATE_OUTPUT].setChannels(numArps);
+
+    // with a poly clock each arp gets its own clock and reset, otherwise they share one.
+    const int clockChannels = TBase::inputs[CLOCK_INPUT].channels;
+    if (clockChannels > 1) {
+        for (int arp = 0; arp < numArps; ++arp) {
+            const int ch = (arp < clockChannels) ? arp : 0;
+            const float clockVoltage = TBase::inputs[CLOCK_INPUT].getVoltage(ch);
+            const float resetVoltage = TBase::inputs[RESET_INPUT].getPolyVoltage(arp);
+            const auto clockResults = clocks[arp].updateOnce(clockVoltage, true, resetVoltage);
+            processClock(arp, clockResults, clocks[arp].getClockValue());
+        }
+    } else {
+        const float clockVoltageX = TBase::inputs[CLOCK_INPUT].getVoltage(0);
+        const float resetVoltage = TBase::inputs[RESET_INPUT].getVoltage(0);
+        const auto clockResults = clocks[0].updateOnce(clockVoltageX, true, resetVoltage);
+        const bool processedClock = clocks[0].getClockValue();
+        for (int arp = 0; arp < numArps; ++arp) {
+            processClock(arp, clockResults, processedClock);
+        }
+    }
+    // SQINFO("~process (exit)");
+}
 
+template <class TBase>
+inline void Arpeggiator<TBase>::processClock(int arp, SeqClock::ClockResults clockResults, bool processedClock) {
     if (clockResults.didReset) {
         // SQDEBUG("did reset");
         clockResults.didClock = true;  // let's force one after this, to get the new value?
-        outerPlayer.reset();
+        voices[arp].outerPlayer.reset();
     }
 
-    const bool processedClock = clock.getClockValue();
-    if (clockResults.didClock || processedClock != lastClock) {
-        // SQDEBUG("didClock=%d , proc=%d last=%d", clockResults.didClock, processedClock, lastClock);
-        lastClock = processedClock;
+    if (clockResults.didClock || processedClock != lastClock[arp]) {
+        // SQDEBUG("didClock=%d , proc=%d last=%d", clockResults.didClock, processedClock, lastClock[arp]);
+        lastClock[arp] = processedClock;
 
-        onClockChange(clockResults.didClock, processedClock);
+        onClockChange(arp, clockResults.didClock, processedClock);
     }
-    // SQINFO("~process (exit)");
 }
 
 template <class TBase>
-inline void Arpeggiator<TBase>::onGateChange(int channel, bool gate) {
-    // SQINFO("Arpeggiator<TBase>::onGateChange will send CV to nb: %f, %f", cv1, cv2);
+inline void Arpeggiator<TBase>::processGates(unsigned gates) {
+    const unsigned changed = gates ^ currentGates;
+    if (changed) {
+        gatesWentOff |= changed & currentGates;
+        currentGates = gates;
+        // the window starts at the first change
+        if (captureCountdown < 0) {
+            captureCountdown = captureSamples;
+        }
+    }
+    if (captureCountdown >= 0) {
+        if (captureCountdown == 0) {
+            commitGates();
+        } else {
+            --captureCountdown;
+        }
+    }
+}
 
-    if (gate) {
-        const float cv1 = TBase::inputs[CV_INPUT].getVoltage(channel);
-        const float cv2 = TBase::inputs[CV2_INPUT].getVoltage(channel);
-        noteBuffer.push_back(cv1, cv2, channel);
-    } else {
-        noteBuffer.removeForChannel(channel);
+template <class TBase>
+inline void Arpeggiator<TBase>::commitGates() {
+    // a gate that went off and back on is a new note, maybe with a new pitch.
+    const unsigned remove = lastGates & gatesWentOff;
+    const unsigned add = currentGates & (~lastGates | gatesWentOff);
+    lastGates = currentGates;
+    gatesWentOff = 0;
+    captureCountdown = -1;
+    allGatesLow = (lastGates == 0);
+    if (!(remove | add)) {
+        return;
     }
 
-    // TODO: get rid of this all gates low stuff
-    allGatesLow = true;
-    for (int i = 0; i < 16; ++i) {
-        if (lastGate[i]) {
-            allGatesLow = false;
+    int removeChannels[maxArps][16];
+    NoteBuffer::Data notes[maxArps][16];
+    int numRemove[maxArps] = {0};
+    int numNotes[maxArps] = {0};
+    for (int ch = 0; ch < 16; ++ch) {
+        const unsigned bit = 1u << ch;
+        const int arp = arpForChannel(ch);
+        if (remove & bit) {
+            removeChannels[arp][numRemove[arp]++] = ch;
+        }
+        if (add & bit) {
+            const float cv1 = TBase::inputs[CV_INPUT].getVoltage(ch);
+            const float cv2 = TBase::inputs[CV2_INPUT].getVoltage(ch);
+            notes[arp][numNotes[arp]++] = NoteBuffer::Data(cv1, cv2, ch);
+        }
+    }
+    for (int arp = 0; arp < maxArps; ++arp) {
+        if (numRemove[arp] || numNotes[arp]) {
+            voices[arp].noteBuffer.update(removeChannels[arp], numRemove[arp], notes[arp], numNotes[arp]);
         }
     }
 }
 
 template <class TBase>
-inline void Arpeggiator<TBase>::onClockChange(bool clockFired, bool clockValue) {
-    SQDEBUG("Arpeg::onClockChange, fired = %d value = %d", clockFired, clockValue);
+inline void Arpeggiator<TBase>::onClockChange(int arp, bool clockFired, bool clockValue) {
+    SQDEBUG("Arpeg::onClockChange, arp=%d fired = %d value = %d", arp, clockFired, clockValue);
     if (clockFired) {
-        const auto cvs = outerPlayer.clock();
+        const auto cvs = voices[arp].outerPlayer.clock();
         // SQINFO("will output player out to CV: %f,%f", cvs.first, cvs.second);
-        TBase::outputs[CV_OUTPUT].setVoltage(cvs.first, 0);
-        TBase::outputs[CV2_OUTPUT].setVoltage(cvs.second, 0);
+        TBase::outputs[CV_OUTPUT].setVoltage(cvs.first, arp);
+        TBase::outputs[CV2_OUTPUT].setVoltage(cvs.second, arp);
     }
 
-    if (hiddenPlayer.empty()) {
+    if (voices[arp].hiddenPlayer.empty()) {
         clockValue = false;
         SQDEBUG("AM muting everything, no notes, clockFired=%d, value=%d", clockFired, clockValue);
     }
@@ -227,7 +420,7 @@ inline void Arpeggiator<TBase>::onClockChange(bool clockFired, bool clockValue)
     const float clockVoltage = clockValue ? cGateOutHi : 0.f;
 
     SQDEBUG("setting gate out to %f", clockVoltage);
-    TBase::outputs[GATE_OUTPUT].setVoltage(clockVoltage, 0);
+    TBase::outputs[GATE_OUTPUT].setVoltage(clockVoltage, arp);
 }
 
 template <class TBase>
@@ -237,7 +430,9 @@ inline void Arpeggiator<TBase>::processParams() {
     //   const bool hold = bool(std::round(TBase::params[HOLD_PARAM].value));
 
     const bool resetMode = bool(std::round(TBase::params[RESET_MODE_PARAM].value));
-    const bool gateDelayEnabled = bool(std::round(TBase::params[GATE_DELAY_PARAM].value));
+    const int gateDelayMode = std::max(0, std::min(2, int(std::round(TBase::params[GATE_DELAY_PARAM].value))));
+    const int seed = std::max(0, int(std::round(TBase::params[SEED_PARAM].value)));
+    const bool noRepeat = bool(std::round(TBase::params[NO_REPEAT_PARAM].value));
 
     int mode = 0;
     if (TBase::inputs[MODE_INPUT].isConnected()) {
@@ -261,10 +456,24 @@ inline void Arpeggiator<TBase>::processParams() {
         hold = bool(std::round(TBase::params[HOLD_PARAM].value));
     }
 
-    outerPlayer.setLength(beats);
-    hiddenPlayer.setMode(ArpegPlayer::Mode(mode));
-    noteBuffer.setCapacity(length);
-    noteBuffer.setHold(hold);
-    clock.setResetMode(resetMode);
-    gateDelay.enableDelay(gateDelayEnabled);
+    // group the input channels, one arpeggiator per group
+    const int perArp = std::max(0, std::min(16, int(std::round(TBase::params[POLY_PARAM].value))));
+    setChannelsPerArp(perArp);
+    const int cvs = TBase::inputs[CV_INPUT].channels;
+    numArps = perArp ? std::max(1, (cvs + perArp - 1) / perArp) : 1;
+
+    // All of them, not just numArps. The ones not playing still get their notes,
+    // so if they come back they have what they would have had.
+    for (int arp = 0; arp < maxArps; ++arp) {
+        ArpVoice& voice = voices[arp];
+        voice.outerPlayer.setLength(beats);
+        voice.hiddenPlayer.setMode(ArpegPlayer::Mode(mode));
+        // each arp gets its own orders
+        voice.hiddenPlayer.setSeed(uint32_t(seed * maxArps + arp));
+        voice.hiddenPlayer.setNoRepeat(noRepeat);
+        voice.noteBuffer.setCapacity(length);
+        voice.noteBuffer.setHold(hold);
+        clocks[arp].setResetMode(resetMode);
+    }
+    gateDelay.setMode(GateDelay::Mode(gateDelayMode));
 }
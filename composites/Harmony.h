@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include "AtomicRingBuffer.h"
 #include "Chord4.h"
 #include "Chord4Manager.h"
@@ -39,10 +42,17 @@ public:
         INVERSION_PREFERENCE_PARAM,
         CENTER_PREFERENCE_PARAM,
         NNIC_PREFERENCE_PARAM,
+        SEVENTH_CHORDS_PARAM,
+        SETTLE_TIME_PARAM,  // milliseconds
+        HYSTERESIS_PARAM,   // semitones
+        INPUT_MODE_PARAM,   // 0 = input is chord root, 1 = input is the soprano melody
+        PIVOT_PARAM,        // on key change, play a chord that is in both keys
+        VOICE_LEADING_PARAM,  // Style::VoiceLeading
         NUM_PARAMS
     };
     enum InputIds {
         CV_INPUT,
+        CHORD_INPUT,  // four poly pitches. Harmony continues on from this chord
         NUM_INPUTS
     };
 
@@ -65,7 +75,7 @@ public:
     public:
         MidiNote pitch[4];  // the four patches
         int root = 0;       // 1..8
-        int inversion = 0;  // 0 = root, 1= first 2 = second
+        int inversion = 0;  // 0 = root, 1= first 2 = second, 3 = third
     };
 
     // called from UI thread
@@ -86,6 +96,13 @@ public:
         return chordManager->_size();
     }
 
+    /**
+     * How many chord searches were run, and how many were skipped because the
+     * input moved on before it settled.
+     */
+    int getSearchCount() const { return searchCount; }
+    int getSuppressedSearchCount() const { return suppressedSearchCount; }
+
     int getOutputChannels(int voice) const {
         int channels = 0;
         switch (voice) {
@@ -105,9 +122,54 @@ public:
         return channels;
     }
 
+    int getNumChannels() const { return numChannels; }
+
+    /**
+     * The last chord recognized on CHORD_INPUT.
+     */
+    Chord4Manager::Recognized getRecognizedChord() const { return recognized; }
+
+protected:
+    /**
+     * Called every time harmonizer channel outputs a new chord.
+     * @param voltages is the four voices, bass first, in V/Oct.
+     */
+    virtual void onChordOutput(int channel, const float* voltages) {}
+
 private:
+    /**
+     * Each channel of the poly CV input gets its own harmonizer.
+     * They all share the chord manager, which none of them modify.
+     */
+    class ChannelState {
+    public:
+        ScaleQuantizerPtr inputQuantizer;  // has hysteresis state, so one per channel
+        const Chord4* chordA = nullptr;
+        const Chord4* chordB = nullptr;
+        float lastQuantizedPitch = -100;
+
+        // When the raw input hasn't changed, and there is no search waiting to happen,
+        // the quantizer output and the chord are already right. So process skips all the work.
+        float lastInputVoltage = -100;
+        bool inputDirty = true;  // forces one full pass, ex: after a key change
+
+        /**
+         * A new root must hold still this long before we search for a chord,
+         * so that a knob or slewed CV sweeping through other degrees doesn't
+         * generate a progression through all of them.
+         */
+        int settleCounter = 0;
+        bool rootPending = false;
+        MidiNote pendingNote;
+    };
+
     void init();
-    void outputPitches(const Chord4*);
+    void processChannel(int channel);
+    void outputPitches(int channel, const Chord4*);
+    void findNextChord(ChannelState&, int channel, const MidiNote&);
+    void findNextChordForMelody(ChannelState&, int channel, const MidiNote&);
+    void lookForChordInput();
+    void continueFrom(ChannelState&, const Chord4*);
     void stepn();
     void updateEverything();
     void lookForKeysigChange();
@@ -117,25 +179,44 @@ private:
      *
      */
     ScaleQuantizer::OptionsPtr quantizerOptions;
-    ScaleQuantizerPtr inputQuantizer;
 
     AtomicRingBuffer<Chord, 12> chordsOut;
 
     Divider divn;
 
+    // Output channel for a voice of harmonizer n is n * voicesOnOutput[voice] + voiceToChannel[voice]
     int voiceToOutput[4] = {BASS_OUTPUT, TENOR_OUTPUT, ALTO_OUTPUT, SOPRANO_OUTPUT};
     int voiceToChannel[4] = {0};
+    int voicesOnOutput[4] = {1, 1, 1, 1};
+
     /**
      * chord finder
      *
      */
-    const Chord4* chordA = nullptr;
-    const Chord4* chordB = nullptr;
+    ChannelState channels[16];
+    int numChannels = 1;
     OptionsPtr chordOptions;
     Chord4ManagerPtr chordManager;
-    float lastQuantizedPitch = -100;
     int count = 0;
     bool mustUpdate = false;
+
+    int settleSamples = 0;
+    bool melodyMode = false;
+    bool pivotOnKeyChange = false;
+
+    /**
+     * Chord tables for the last few settings we have used, most recent first.
+     * Building the tables is slow, and going back and forth between
+     * two keys is common.
+     */
+    static const int managerCacheSize = 4;
+    std::vector<std::pair<int, Chord4ManagerPtr>> managerCache;
+    Chord4ManagerPtr getManager();
+
+    float lastChordInput[4] = {-100, -100, -100, -100};
+    Chord4Manager::Recognized recognized;
+    int searchCount = 0;
+    int suppressedSearchCount = 0;
 };
 
 template <class TBase>
@@ -149,9 +230,11 @@ inline void Harmony<TBase>::init() {
     quantizerOptions = std::make_shared<ScaleQuantizer::Options>();
     quantizerOptions->scale = std::make_shared<Scale>();
     quantizerOptions->scale->set(MidiNote::C, Scale::Scales::Major);
-    inputQuantizer = std::make_shared<ScaleQuantizer>(quantizerOptions);
+    for (auto& state : channels) {
+        state.inputQuantizer = std::make_shared<ScaleQuantizer>(quantizerOptions);
+    }
 
-    chordManager = std::make_shared<Chord4Manager>(*chordOptions);
+    chordManager = getManager();
     assert(chordManager->isValid());
 
     divn.setup(32, [this]() {
@@ -165,7 +248,11 @@ inline void Harmony<TBase>::stepn() {
     assert(ALTO_OUTPUT == (TENOR_OUTPUT + 1));
     assert(SOPRANO_OUTPUT == (ALTO_OUTPUT + 1));
 
-    // figure out the voice to jack assignments
+    numChannels = std::max(1, Harmony<TBase>::inputs[CV_INPUT].getChannels());
+    Harmony<TBase>::outputs[QUANTIZER_OUTPUT].setChannels(numChannels);
+
+    // figure out the voice to jack assignments.
+    // with poly input each harmonizer gets a block of channels on each output.
     int nextVoiceToAssign = 0;
     int debt = 0;
     for (int portIndex = 0; portIndex < 4; ++portIndex) {
@@ -173,11 +260,12 @@ inline void Harmony<TBase>::stepn() {
         const bool connected = Harmony<TBase>::outputs[x].isConnected();
         if (connected) {
             // SQINFO("assign output %d with %d voices", portIndex, 1 + debt);
-            Harmony<TBase>::outputs[x].setChannels(1 + debt);
+            Harmony<TBase>::outputs[x].setChannels(std::min(16, numChannels * (1 + debt)));
 
             for (int i = 0; i <= debt; ++i) {
                 voiceToOutput[nextVoiceToAssign] = x;
                 voiceToChannel[nextVoiceToAssign] = i;
+                voicesOnOutput[nextVoiceToAssign] = 1 + debt;
                 ++nextVoiceToAssign;
             }
             debt = 0;
@@ -198,6 +286,21 @@ inline void Harmony<TBase>::stepn() {
 
     const Style::InversionPreference ip = Style::InversionPreference(int(std::round(Harmony<TBase>::params[INVERSION_PREFERENCE_PARAM].value)));
     style->setInversionPreference(ip);
+    style->setVoiceLeading(Style::VoiceLeading(int(std::round(Harmony<TBase>::params[VOICE_LEADING_PARAM].value))));
+
+    const float settleMs = Harmony<TBase>::params[SETTLE_TIME_PARAM].value;
+    settleSamples = int(settleMs * .001f * TBase::engineGetSampleRate());
+    quantizerOptions->hysteresis = Harmony<TBase>::params[HYSTERESIS_PARAM].value;
+
+    const bool sevenths = Harmony<TBase>::params[SEVENTH_CHORDS_PARAM].value > .5;
+    if (style->getSeventhChords() != sevenths) {
+        style->setSeventhChords(sevenths);
+        mustUpdate = true;
+    }
+
+    const bool melody = Harmony<TBase>::params[INPUT_MODE_PARAM].value > .5;
+    melodyMode = melody;
+    pivotOnKeyChange = Harmony<TBase>::params[PIVOT_PARAM].value > .5;
 
     lookForKeysigChange();
 }
@@ -218,7 +321,7 @@ inline void Harmony<TBase>::lookForKeysigChange() {
 }
 
 template <class TBase>
-inline void Harmony<TBase>::outputPitches(const Chord4* chord) {
+inline void Harmony<TBase>::outputPitches(int channel, const Chord4* chord) {
     const HarmonyNote* harmonyNotes = chord->fetchNotes();
 
     // Chord c is just used for passing to UI for score drawing.
@@ -226,6 +329,7 @@ inline void Harmony<TBase>::outputPitches(const Chord4* chord) {
     Chord c;
     c.root = chord->fetchRoot();
     c.inversion = int(chord->inversion(*chordOptions));
+    float voltages[4];
 
     // SQINFO("output pitches %s (bass=%d)", chord->toStringShort().c_str(), (int)harmonyNotes[0]);
 
@@ -234,12 +338,20 @@ inline void Harmony<TBase>::outputPitches(const Chord4* chord) {
         FloatNote fn;
         NoteConvert::m2f(fn, mn);
         const int outputPort = voiceToOutput[i];
-        const int outputChannel = voiceToChannel[i];
-        Harmony<TBase>::outputs[outputPort].setVoltage(fn.get(), outputChannel);
+        const int outputChannel = channel * voicesOnOutput[i] + voiceToChannel[i];
+        if (outputChannel < 16) {
+            Harmony<TBase>::outputs[outputPort].setVoltage(fn.get(), outputChannel);
+        }
         // SQINFO("set output[%d] to %f from base pitch %f", i, fn.get(), fn.get());
         c.pitch[i] = mn.get();
+        voltages[i] = fn.get();
     }
+    onChordOutput(channel, voltages);
 
+    // the score only shows the first channel
+    if (channel != 0) {
+        return;
+    }
     if (!chordsOut.full()) {
         chordsOut.push(c);
     } else {
@@ -247,13 +359,76 @@ inline void Harmony<TBase>::outputPitches(const Chord4* chord) {
     }
 }
 
+template <class TBase>
+inline Chord4ManagerPtr Harmony<TBase>::getManager() {
+    const auto keysig = chordOptions->keysig->get();
+    const auto style = chordOptions->style;
+    const int key = keysig.first.get() |
+                    (int(keysig.second) << 8) |
+                    (int(style->getRangesPreference()) << 16) |
+                    (int(style->getSeventhChords()) << 20);
+    for (auto it = managerCache.begin(); it != managerCache.end(); ++it) {
+        if (it->first == key) {
+            auto ret = *it;
+            managerCache.erase(it);
+            managerCache.insert(managerCache.begin(), ret);
+            return ret.second;
+        }
+    }
+    auto ret = std::make_shared<Chord4Manager>(*chordOptions);
+    if (int(managerCache.size()) >= managerCacheSize) {
+        managerCache.pop_back();
+    }
+    managerCache.insert(managerCache.begin(), std::make_pair(key, ret));
+    return ret;
+}
+
+/**
+ * Switch to the tables for the current settings. The chord history is moved
+ * into the new tables, so voice leading carries on across a key change.
+ * Old chords that aren't legal any more are dropped, or, optionally,
+ * replaced by a pivot chord.
+ */
 template <class TBase>
 inline void Harmony<TBase>::updateEverything() {
-    chordManager = std::make_shared<Chord4Manager>(*chordOptions);
+    const Chord4ManagerPtr oldManager = chordManager;  // keeps the old chords alive
+    chordManager = getManager();
     mustUpdate = false;
     assert(chordManager->isValid());
-    chordA = nullptr;
-    chordB = nullptr;
+    for (int channel = 0; channel < 16; ++channel) {
+        ChannelState& state = channels[channel];
+        state.inputDirty = true;  // quantizer may have a new scale
+        if (oldManager == chordManager) {
+            continue;
+        }
+        const Chord4* oldA = state.chordA;
+        const Chord4* oldB = state.chordB;
+        state.chordA = nullptr;
+        state.chordB = nullptr;
+
+        const Chord4* a = oldA ? HarmonyChords::remap(*chordManager, *oldA) : nullptr;
+        const Chord4* b = oldB ? HarmonyChords::remap(*chordManager, *oldB) : nullptr;
+        const Chord4* last = oldB ? oldB : oldA;
+        const bool lastDropped = last && !(oldB ? b : a);
+        if (lastDropped && pivotOnKeyChange && (channel < numChannels)) {
+            const Chord4* pivot = HarmonyChords::findPivotChord(*chordManager, *oldManager, *last);
+            if (pivot) {
+                outputPitches(channel, pivot);
+                if (oldB) {
+                    b = pivot;
+                } else {
+                    a = pivot;
+                }
+            }
+        }
+        if (a) {
+            continueFrom(state, a);
+        }
+        if (b) {
+            continueFrom(state, b);
+        }
+    }
+    lastChordInput[0] = -100;  // recognize it again in the new key
 }
 
 template <class TBase>
@@ -263,49 +438,161 @@ inline void Harmony<TBase>::process(const typename TBase::ProcessArgs& args) {
     if (mustUpdate) {
         updateEverything();
     }
-    //   static int count = 0;
-    const float input = Harmony<TBase>::inputs[CV_INPUT].getVoltage(0);
+    lookForChordInput();
+    for (int channel = 0; channel < numChannels; ++channel) {
+        processChannel(channel);
+    }
+
+    if (mustUpdate) {
+        updateEverything();
+    }
+}
+
+template <class TBase>
+inline void Harmony<TBase>::processChannel(int channel) {
+    ChannelState& state = channels[channel];
+    const float input = Harmony<TBase>::inputs[CV_INPUT].getVoltage(channel);
+    if ((input == state.lastInputVoltage) && !state.rootPending && !state.inputDirty) {
+        return;
+    }
+    state.lastInputVoltage = input;
+    state.inputDirty = false;
+
     assert(chordManager);
-    MidiNote mn = inputQuantizer->run(input);
+    MidiNote mn = state.inputQuantizer->run(input);
     FloatNote quantizedNote;
     NoteConvert::m2f(quantizedNote, mn);
-    Harmony<TBase>::outputs[QUANTIZER_OUTPUT].setVoltage(quantizedNote.get(), 0);
-
-    // generate a new chord any time the quantizer outputs a new pitch
-    if (quantizedNote.get() != lastQuantizedPitch) {
-        ScaleNote scaleNote;
-        NoteConvert::m2s(scaleNote, *quantizerOptions->scale, mn);
-
-        bool octaveJump = false;
-        if (chordB) {
-            octaveJump = (chordB->fetchRoot() == (1 + scaleNote.getDegree()));
-        } else if (chordA) {
-            octaveJump = (chordA->fetchRoot() == (1 + scaleNote.getDegree()));
+    Harmony<TBase>::outputs[QUANTIZER_OUTPUT].setVoltage(quantizedNote.get(), channel);
+
+    // generate a new chord any time the quantizer outputs a new pitch,
+    // after it has settled.
+    if (quantizedNote.get() != state.lastQuantizedPitch) {
+        if (state.rootPending) {
+            ++suppressedSearchCount;
         }
-        if (octaveJump) {
-            printf("\nignoring octave jump\n");
+        state.rootPending = true;
+        state.pendingNote = mn;
+        state.settleCounter = settleSamples;
+        state.lastQuantizedPitch = quantizedNote.get();
+    }
+
+    if (state.rootPending) {
+        if (state.settleCounter > 0) {
+            --state.settleCounter;
         } else {
-            const bool show = false;
-            // If it's our first chord, generate single.
-            // TODO: shouldn't we have done this before? What are we outputting?
-            if (!chordA) {
-                chordA = HarmonyChords::findChord(show, *chordOptions, *chordManager, 1 + scaleNote.getDegree());
-                outputPitches(chordA);
-            } else if (!chordB) {
-                chordB = HarmonyChords::findChord(show, *chordOptions, *chordManager, *chordA, 1 + scaleNote.getDegree());
-                outputPitches(chordB);
+            state.rootPending = false;
+            if (melodyMode) {
+                findNextChordForMelody(state, channel, state.pendingNote);
             } else {
-                const Chord4* chord = HarmonyChords::findChord(show, *chordOptions, *chordManager, *chordA, *chordB, 1 + scaleNote.getDegree());
-                outputPitches(chord);
-                chordA = chordB;
-                chordB = chord;
+                findNextChord(state, channel, state.pendingNote);
             }
         }
+    }
+}
 
-        lastQuantizedPitch = quantizedNote.get();
+template <class TBase>
+inline void Harmony<TBase>::findNextChord(ChannelState& state, int channel, const MidiNote& mn) {
+    ScaleNote scaleNote;
+    NoteConvert::m2s(scaleNote, *quantizerOptions->scale, mn);
+
+    bool octaveJump = false;
+    if (state.chordB) {
+        octaveJump = (state.chordB->fetchRoot() == (1 + scaleNote.getDegree()));
+    } else if (state.chordA) {
+        octaveJump = (state.chordA->fetchRoot() == (1 + scaleNote.getDegree()));
     }
+    if (octaveJump) {
+        printf("\nignoring octave jump\n");
+    } else {
+        const bool show = false;
+        // If it's our first chord, generate single.
+        // TODO: shouldn't we have done this before? What are we outputting?
+        if (!state.chordA) {
+            state.chordA = HarmonyChords::findChord(show, *chordOptions, *chordManager, 1 + scaleNote.getDegree());
+            outputPitches(channel, state.chordA);
+        } else if (!state.chordB) {
+            state.chordB = HarmonyChords::findChord(show, *chordOptions, *chordManager, *state.chordA, 1 + scaleNote.getDegree());
+            outputPitches(channel, state.chordB);
+        } else {
+            const Chord4* chord = HarmonyChords::findChord(show, *chordOptions, *chordManager, *state.chordA, *state.chordB, 1 + scaleNote.getDegree());
+            outputPitches(channel, chord);
+            state.chordA = state.chordB;
+            state.chordB = chord;
+        }
+        ++searchCount;
+    }
+}
 
-    if (mustUpdate) {
-        updateEverything();
+template <class TBase>
+inline void Harmony<TBase>::findNextChordForMelody(ChannelState& state, int channel, const MidiNote& mn) {
+    // harmony notes are an octave off from midi notes (see outputPitches)
+    const int soprano = chordManager->closestSoprano(mn.get() - 12);
+    if (soprano < 0) {
+        return;
     }
-}
\ No newline at end of file
+    const Chord4* prev = state.chordB ? state.chordB : state.chordA;
+    const Chord4* prevPrev = state.chordB ? state.chordA : nullptr;
+    if (prev && (int(prev->fetchNotes()[3]) == soprano)) {
+        return;  // melody note didn't move, ex: folded into range
+    }
+
+    const Chord4* chord = HarmonyChords::findChordForMelody(false, *chordOptions, *chordManager, prevPrev, prev, soprano);
+    assert(chord);
+    outputPitches(channel, chord);
+    // if only the previous root has this soprano we get a re-voicing of it,
+    // and continueFrom will start the history over.
+    continueFrom(state, chord);
+    ++searchCount;
+}
+
+template <class TBase>
+inline void Harmony<TBase>::lookForChordInput() {
+    auto& input = Harmony<TBase>::inputs[CHORD_INPUT];
+    if (input.getChannels() < 4) {
+        return;
+    }
+    bool changed = false;
+    for (int i = 0; i < 4; ++i) {
+        const float v = input.getVoltage(i);
+        if (v != lastChordInput[i]) {
+            lastChordInput[i] = v;
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    int pitches[4];
+    for (int i = 0; i < 4; ++i) {
+        MidiNote mn;
+        NoteConvert::f2m(mn, FloatNote(lastChordInput[i]));
+        pitches[i] = mn.get() - 12;  // harmony notes are an octave off from midi notes
+    }
+    recognized = chordManager->recognize(pitches);
+    if (recognized.rank < 0) {
+        return;  // not a voicing we can lead from
+    }
+    const Chord4* chord = chordManager->get2(recognized.root, recognized.rank);
+    for (int channel = 0; channel < numChannels; ++channel) {
+        continueFrom(channels[channel], chord);
+    }
+}
+
+/**
+ * Make chord the most recent chord in the history, without outputting it,
+ * so the next search voice leads from it.
+ */
+template <class TBase>
+inline void Harmony<TBase>::continueFrom(ChannelState& state, const Chord4* chord) {
+    const int root = chord->fetchRoot();
+    const Chord4* prev = state.chordB ? state.chordB : state.chordA;
+    if (prev && (prev->fetchRoot() != root)) {
+        state.chordA = prev;
+        state.chordB = chord;
+    } else {
+        // searches can't have two of the same root in a row, so start over.
+        state.chordA = chord;
+        state.chordB = nullptr;
+    }
+}
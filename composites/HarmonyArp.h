@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cmath>
+
+#include "ArpegPlayer.h"
+#include "ArpegRhythmPlayer.h"
+#include "Constants.h"
+#include "Harmony.h"
+#include "NoteBuffer.h"
+#include "SeqClock.h"
+
+/**
+ * Harmony feeding an Arpeggiator, in one module.
+ *
+ * Same as patching Harmony's voices into the Arpeggiator with a poly cable,
+ * but each new chord goes straight into the note buffer as one change, so
+ * the player refills once per chord. There are no gates in between, so
+ * there is no gate delay either: a chord is playable on the same sample
+ * it is found.
+ *
+ * Harmonizer channel n owns note buffer channels 4n..4n+3.
+ */
+template <class TBase>
+class HarmonyArp : public Harmony<TBase> {
+public:
+    using Base = Harmony<TBase>;
+    HarmonyArp(Module* module) : Base(module) {
+        init();
+    }
+    HarmonyArp() : Base() {
+        init();
+    }
+
+    enum ParamIds {
+        ARP_MODE_PARAM = Base::NUM_PARAMS,
+        ARP_LENGTH_PARAM,  // how many notes we hold in the buffer
+        ARP_BEATS_PARAM,   // how we play the pattern back
+        ARP_HOLD_PARAM,    // if true, new chords add on to the old ones
+        ARP_RESET_MODE_PARAM,
+        NUM_PARAMS
+    };
+
+    enum InputIds {
+        CLOCK_INPUT = Base::NUM_INPUTS,
+        RESET_INPUT,
+        NUM_INPUTS
+    };
+
+    enum OutputIds {
+        ARP_CV_OUTPUT = Base::NUM_OUTPUTS,
+        ARP_GATE_OUTPUT,
+        NUM_OUTPUTS
+    };
+
+    enum LightIds {
+        NUM_LIGHTS = Base::NUM_LIGHTS
+    };
+
+    void process(const typename TBase::ProcessArgs& args) override;
+
+    const NoteBuffer& getNoteBuffer() const { return noteBuffer; }
+
+protected:
+    void onChordOutput(int channel, const float* voltages) override;
+
+private:
+    void init();
+    void processParams();
+    void onClockChange(bool clockFired, bool clockValue);
+
+    NoteBuffer noteBuffer{32};
+    ArpegPlayer hiddenPlayer{&noteBuffer};
+    ArpegRhythmPlayer outerPlayer{&hiddenPlayer};
+    SeqClock clock;
+    bool lastClock = false;
+    bool lastHold = false;
+    int lastNumChannels = 1;
+
+    // so the chords can go back in when hold is released
+    NoteBuffer::Data lastChord[16][4];
+    bool haveChord[16] = {false};
+
+    const int numModes = {int(ArpegPlayer::modes().size())};
+};
+
+template <class TBase>
+inline void HarmonyArp<TBase>::init() {
+    clock.setResetMode(true);
+}
+
+template <class TBase>
+inline void HarmonyArp<TBase>::onChordOutput(int channel, const float* voltages) {
+    for (int i = 0; i < 4; ++i) {
+        lastChord[channel][i] = NoteBuffer::Data(voltages[i], 0, channel * 4 + i);
+    }
+    haveChord[channel] = true;
+    noteBuffer.replaceChannels(channel * 4, 4, lastChord[channel], 4);
+}
+
+template <class TBase>
+inline void HarmonyArp<TBase>::process(const typename TBase::ProcessArgs& args) {
+    processParams();
+    Base::process(args);
+
+    // if harmonizers went away, so do their chords
+    const int numChannels = Base::getNumChannels();
+    if (numChannels < lastNumChannels) {
+        noteBuffer.replaceChannels(numChannels * 4, (lastNumChannels - numChannels) * 4, nullptr, 0);
+        for (int channel = numChannels; channel < lastNumChannels; ++channel) {
+            haveChord[channel] = false;
+        }
+    }
+    lastNumChannels = numChannels;
+
+    outerPlayer.armReShuffle();
+    const float clockVoltage = TBase::inputs[CLOCK_INPUT].getVoltage(0);
+    const float resetVoltage = TBase::inputs[RESET_INPUT].getVoltage(0);
+    auto clockResults = clock.updateOnce(clockVoltage, true, resetVoltage);
+
+    if (clockResults.didReset) {
+        clockResults.didClock = true;
+        outerPlayer.reset();
+    }
+
+    const bool processedClock = clock.getClockValue();
+    if (clockResults.didClock || processedClock != lastClock) {
+        lastClock = processedClock;
+        onClockChange(clockResults.didClock, processedClock);
+    }
+}
+
+template <class TBase>
+inline void HarmonyArp<TBase>::onClockChange(bool clockFired, bool clockValue) {
+    if (clockFired) {
+        const auto cvs = outerPlayer.clock();
+        TBase::outputs[ARP_CV_OUTPUT].setVoltage(cvs.first, 0);
+    }
+    if (hiddenPlayer.empty()) {
+        clockValue = false;
+    }
+    TBase::outputs[ARP_GATE_OUTPUT].setVoltage(clockValue ? cGateOutHi : 0.f, 0);
+}
+
+template <class TBase>
+inline void HarmonyArp<TBase>::processParams() {
+    const int length = int(std::round(TBase::params[ARP_LENGTH_PARAM].value));
+    const int beats = int(std::round(TBase::params[ARP_BEATS_PARAM].value));
+    const bool hold = bool(std::round(TBase::params[ARP_HOLD_PARAM].value));
+    const bool resetMode = bool(std::round(TBase::params[ARP_RESET_MODE_PARAM].value));
+    int mode = int(std::round(TBase::params[ARP_MODE_PARAM].value));
+    mode = std::max(0, std::min(mode, numModes - 1));
+
+    outerPlayer.setLength(beats);
+    hiddenPlayer.setMode(ArpegPlayer::Mode(mode));
+
+    // always room for a chord from every harmonizer, or they would push each other out.
+    // Base::process hasn't looked at the input yet, so count the channels here.
+    const int numChannels = std::max(1, TBase::inputs[Base::CV_INPUT].getChannels());
+    const int capacity = (length > 0) ? length : NoteBuffer::defaultCapacity;
+    noteBuffer.setCapacity(std::max(capacity, 4 * numChannels));
+    if (hold != lastHold) {
+        lastHold = hold;
+        noteBuffer.setHold(hold);
+        if (!hold) {
+            // releasing hold clears the buffer. Keep playing the current chords.
+            for (int channel = 0; channel < 16; ++channel) {
+                if (haveChord[channel]) {
+                    noteBuffer.replaceChannels(channel * 4, 4, lastChord[channel], 4);
+                }
+            }
+        }
+    }
+    clock.setResetMode(resetMode);
+}
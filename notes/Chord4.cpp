@@ -20,17 +20,18 @@ int __numChord4 = 0;
 
 /*  Chord4::Chord4(int nRoot)
  */
-Chord4::Chord4(const Options& options, int nRoot) : root(nRoot) {
+template <int NUM_VOICES>
+ChordN<NUM_VOICES>::ChordN(const Options& options, int nRoot) : root(nRoot) {
     __numChord4++;
-    assert(root > 0 && root < 8);
+    assert(root > 0 && root <= options.keysig->numDegrees());
 
-    for (int i = 0; i < CHORD_SIZE; ++i) {
+    for (int i = 0; i < NUM_VOICES; ++i) {
         _notes.push_back(HarmonyNote(options));
     }
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
     // now _notes has 4 notes, they are all the same path - the min pitch specificied by the style
 
-    for (int index = 0; index < CHORD_SIZE; index++) {
+    for (int index = 0; index < NUM_VOICES; index++) {
         while (_notes[index] < options.style->absMinPitch()) {
             ++_notes[index];
         }
@@ -50,20 +51,41 @@ Chord4::Chord4(const Options& options, int nRoot) : root(nRoot) {
     valid = true;
 }
 
+template <int NUM_VOICES>
+ChordN<NUM_VOICES>::ChordN(const Options& options, int nRoot, Packed voicing) : root(nRoot) {
+    __numChord4++;
+    assert(root > 0 && root <= options.keysig->numDegrees());
+
+    bool inRange = true;
+    for (int i = 0; i < NUM_VOICES; ++i) {
+        HarmonyNote note(options);
+        note.setPitchDirectly(unpack(voicing, i));
+        if (note < options.style->absMinPitch() || note.isTooHigh(options)) {
+            inRange = false;
+        }
+        _notes.push_back(note);
+    }
+    makeSrnNotes(options);
+    valid = inRange && isChordOk(options);
+}
+
 // TODO: get rid of this!
-Chord4::Chord4() : root(1) {
+template <int NUM_VOICES>
+ChordN<NUM_VOICES>::ChordN() : root(1) {
     valid = true;
     __numChord4++;
 }
 
-Chord4::~Chord4() {
+template <int NUM_VOICES>
+ChordN<NUM_VOICES>::~ChordN() {
     __numChord4--;
     assert(__numChord4 >= 0);
 }
 
 /*  int Chord4::Quality() const
  */
-int Chord4::quality(const Options& options, bool fTalk) const {
+template <int NUM_VOICES>
+int ChordN<NUM_VOICES>::quality(const Options& options, bool fTalk) const {
     assert(valid);
     int ret;
     int nTotalDivergence = divergence(options);
@@ -76,35 +98,19 @@ int Chord4::quality(const Options& options, bool fTalk) const {
 
 /*  int Chord4::Divergence() const
  */
-int Chord4::divergence(const Options& options) const {
+template <int NUM_VOICES>
+int ChordN<NUM_VOICES>::divergence(const Options& options) const {
     int nTotalDivergence = 0;
-    int s, a, t, b;
-    int target;
 
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
 
     auto style = options.style;
-    target = style->minSop() + style->maxSop();
-    target /= 2;
-    s = target - _notes[3];
-    s *= s;
-
-    target = style->minAlto() + style->maxAlto();
-    target /= 2;
-    a = target - _notes[2];
-    a *= a;
-
-    target = style->minTenor() + style->maxTenor();
-    target /= 2;
-    t = target - _notes[1];
-    t *= t;
-
-    target = style->minBass() + style->maxBass();
-    target /= 2;
-    b = target - _notes[0];
-    b *= b;
-
-    nTotalDivergence = s + a + t + b;
+    for (int nVoice = 0; nVoice < NUM_VOICES; ++nVoice) {
+        int target = style->minPitch(nVoice, NUM_VOICES) + style->maxPitch(nVoice, NUM_VOICES);
+        target /= 2;
+        const int d = target - _notes[nVoice];
+        nTotalDivergence += d * d;
+    }
 
     return nTotalDivergence;
 }
@@ -112,59 +118,115 @@ int Chord4::divergence(const Options& options) const {
 /* void Chord4::Print() const
  */
 
-std::string Chord4::getString() const {
+template <int NUM_VOICES>
+std::string ChordN<NUM_VOICES>::getString() const {
     assert(valid);
     std::stringstream s;
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
 
     s << "Root: ";
     s << root;
     s << "  ";
-    for (int i = 0; i < CHORD_SIZE; i++) {
+    for (int i = 0; i < NUM_VOICES; i++) {
         s << _notes[i].tellPitchName();
     }
     return s.str();
 }
 
-std::string Chord4::toStringShort() const {
+template <int NUM_VOICES>
+std::string ChordN<NUM_VOICES>::toStringShort() const {
+    char buffer[maxStringLength + 1];
+    format(buffer);
+    return buffer;
+}
+
+template <int NUM_VOICES>
+int ChordN<NUM_VOICES>::format(char* buffer) const {
     assert(valid);
-    std::stringstream s;
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
 
-    for (int i = 0; i < CHORD_SIZE; i++) {
-        s << _notes[i].tellPitchName();
+    int length = 0;
+    for (int i = 0; i < NUM_VOICES; i++) {
+        length += PitchKnowledge::formatAbs(_notes[i], buffer + length);
     }
-    return s.str();
+    assert(length <= maxStringLength);
+    return length;
+}
+
+template <int NUM_VOICES>
+typename ChordN<NUM_VOICES>::Packed ChordN<NUM_VOICES>::pack(const int* pitches) {
+    Packed ret = 0;
+    for (int i = 0; i < NUM_VOICES; i++) {
+        assert(pitches[i] >= 0 && pitches[i] < 256);
+        ret |= Packed(pitches[i]) << (8 * i);
+    }
+    return ret;
+}
+
+template <int NUM_VOICES>
+typename ChordN<NUM_VOICES>::Packed ChordN<NUM_VOICES>::packed() const {
+    int pitches[NUM_VOICES];
+    for (int i = 0; i < NUM_VOICES; i++) {
+        pitches[i] = _notes[i];
+    }
+    return pack(pitches);
+}
+
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::parse(const char* str, Packed& outVoicing) {
+    int pitches[NUM_VOICES];
+    for (int i = 0; i < NUM_VOICES; i++) {
+        const int length = PitchKnowledge::parseAbs(str, pitches[i]);
+        if (length == 0) {
+            return false;
+        }
+        str += length;
+    }
+    if (*str != 0) {
+        return false;  // too many notes, or junk at the end
+    }
+    outVoicing = pack(pitches);
+    return true;
 }
 
 #ifdef _DEBUG
-void Chord4::dump() const {
+template <int NUM_VOICES>
+void ChordN<NUM_VOICES>::dump() const {
     print();
 }
 #endif
 
-void Chord4::print() const {
+template <int NUM_VOICES>
+void ChordN<NUM_VOICES>::print() const {
     auto str = getString();
     SQINFO("%s", str.c_str());
     // std::cout << str;
 }
 
-Chord4Ptr Chord4::fromString(const Options& options, int degree, const char* target) {
-    Chord4Ptr chord = std::make_shared<Chord4>(options, degree);
-    while (true) {
-        if (chord->toStringShort() == target) {
-            return chord;
-        }
-        bool error = chord->makeNext(options);
-        if (error) {
-            return nullptr;
-        }
+template <int NUM_VOICES>
+typename ChordN<NUM_VOICES>::ChordNPtr ChordN<NUM_VOICES>::fromString(const Options& options, int degree, const char* target) {
+    Packed voicing;
+    if (!parse(target, voicing)) {
+        return nullptr;
+    }
+    return fromPacked(options, degree, voicing);
+}
+
+template <int NUM_VOICES>
+typename ChordN<NUM_VOICES>::ChordNPtr ChordN<NUM_VOICES>::fromPacked(const Options& options, int degree, Packed voicing) {
+    // makeNext visits every voicing that passes isChordOk, so checking that is the same
+    // as searching for it.
+    ChordNPtr chord(new ChordN(options, degree, voicing));
+    if (!chord->isValid()) {
+        return nullptr;
     }
+    return chord;
 }
 
 /* void Chord4::BumpToNextInChord(Note note)
  */
-void Chord4::bumpToNextInChord(const Options& options, HarmonyNote& note) {
+template <int NUM_VOICES>
+void ChordN<NUM_VOICES>::bumpToNextInChord(const Options& options, HarmonyNote& note) {
     const bool b = false;
 
     if (b && false) {
@@ -186,16 +248,17 @@ void Chord4::bumpToNextInChord(const Options& options, HarmonyNote& note) {
 
 /* bool Chord4::inc()
  */
-bool Chord4::inc(const Options& options) {
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::inc(const Options& options) {
     int nVoice;
     bool fRet = false;  // assume no error
 
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
 
-    ++_notes[CHORD_SIZE - 1];  // inc to next pitch
-    bumpToNextInChord(options, _notes[CHORD_SIZE - 1]);
+    ++_notes[NUM_VOICES - 1];  // inc to next pitch
+    bumpToNextInChord(options, _notes[NUM_VOICES - 1]);
 
-    for (nVoice = CHORD_SIZE - 1; nVoice >= 0; nVoice--) {
+    for (nVoice = NUM_VOICES - 1; nVoice >= 0; nVoice--) {
         if (_notes[nVoice].isTooHigh(options))  // If we inced too far
                                                 // I.E. this voice is out of range..
         {
@@ -228,7 +291,8 @@ bool Chord4::inc(const Options& options) {
     return fRet;
 }
 
-bool Chord4::makeNext(const Options& options) {
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::makeNext(const Options& options) {
     bool fDone;
     bool fError;
 
@@ -247,16 +311,18 @@ bool Chord4::makeNext(const Options& options) {
     return fError;
 }
 
-void Chord4::makeSrnNotes(const Options& op) {
+template <int NUM_VOICES>
+void ChordN<NUM_VOICES>::makeSrnNotes(const Options& op) {
     int i;
 
-    assert(_notes.size() == CHORD_SIZE);
-    for (i = 0; i < CHORD_SIZE; i++) {
+    assert(_notes.size() == NUM_VOICES);
+    for (i = 0; i < NUM_VOICES; i++) {
         srnNotes[i] = op.keysig->ScaleDeg(_notes[i]);  // compute the scale rel ones for other guys to use
     }
 }
 
-bool Chord4::isChordOk(const Options& options) const {
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::isChordOk(const Options& options) const {
     bool ret = true;
     int i, nPitch;
 
@@ -268,13 +334,13 @@ bool Chord4::isChordOk(const Options& options) const {
 #endif
 
     auto style = options.style;
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
     if (!style->allowVoiceCrossing())  // If we require that two voices never cross
                                        // (meaning alto can never be higher than sop)
     {
         int nVoice;
 
-        for (nPitch = -1, nVoice = 0; nVoice < CHORD_SIZE; nVoice++) {
+        for (nPitch = -1, nVoice = 0; nVoice < NUM_VOICES; nVoice++) {
             if (_notes[nVoice] < nPitch) {  // If the next voice is NOT higher than the last
                                             // 11/25 allow same pitch.  This is NG! allows all 4 notes the same!
                                             //   if (b) printf("isChordOk not ok at 248\n");
@@ -299,6 +365,9 @@ bool Chord4::isChordOk(const Options& options) const {
         case SECOND_INVERSION:
             InvOk = style->allow2ndInversion();
             break;
+        case THIRD_INVERSION:
+            InvOk = style->allow3rdInversion();
+            break;
         default:
             InvOk = false;
     }
@@ -315,7 +384,7 @@ bool Chord4::isChordOk(const Options& options) const {
     bool test[128];
     int matches;
     memset(test, 0, sizeof(test));  // clear our test hit array
-    for (i = matches = 0; i < CHORD_SIZE; i++) {
+    for (i = matches = 0; i < NUM_VOICES; i++) {
         nPitch = _notes[i];           // get the pitch of this chord member
         if (test[nPitch]) matches++;  // if someone at this pitch, count us
         test[nPitch] = true;          // mark that we are here
@@ -326,7 +395,7 @@ bool Chord4::isChordOk(const Options& options) const {
         // If more unisons in the chord than we allow
     }
 
-    for (i = CHORD_SIZE - 1; i >= 0; i--) {
+    for (i = NUM_VOICES - 1; i >= 0; i--) {
         if (!isInChord(options, _notes[i])) {
             // if (b) printf("isChordOk not ok at 294\n");
             return false;
@@ -350,61 +419,43 @@ bool Chord4::isChordOk(const Options& options) const {
     return ret;
 }
 
-bool Chord4::pitchesInRange(const Options& options) const {
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::pitchesInRange(const Options& options) const {
     const HarmonyNote* notes = fetchNotes();
     auto style = options.style;
 
-    const int bass = notes[0];
-    const int tenor = notes[1];
-    const int alto = notes[2];
-    const int soprano = notes[3];
-    if (bass < style->minBass() || bass > style->maxBass()) {
-        return false;
-    }
-    if (tenor < style->minTenor() || tenor > style->maxTenor()) {
-        return false;
-    }
-    if (alto < style->minAlto() || alto > style->maxAlto()) {
-        return false;
-    }
-    if (soprano < style->minSop() || soprano > style->maxSop()) {
-        return false;
+    for (int nVoice = 0; nVoice < NUM_VOICES; ++nVoice) {
+        const int pitch = notes[nVoice];
+        if (pitch < style->minPitch(nVoice, NUM_VOICES) || pitch > style->maxPitch(nVoice, NUM_VOICES)) {
+            return false;
+        }
     }
     return true;
 }
 
-bool Chord4::isAcceptableDoubling(const Options& options) const {
-    int nRoots = 0, nThirds = 0, nFifths = 0;
-
-
-    for (int nVoice = 0; nVoice < CHORD_SIZE; nVoice++)  // loop over all notes in chord
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::isAcceptableDoubling(const Options& options) const {
+    int rolesPresent = 0;
+    for (int nVoice = 0; nVoice < NUM_VOICES; nVoice++)  // loop over all notes in chord
     {
-        switch (chordInterval(options, _notes[nVoice])) {
-            case 1:
-                nRoots++;
-                break;
-            case 3:
-                nThirds++;
-                break;
-            case 5:
-                nFifths++;
-                break;
-            default:
-                SQWARN("dlb of non-diatonic");
-                assert(false);
-        }
+        const int role = chordInterval(options, _notes[nVoice]);
+        assert(role != 0);
+        rolesPresent |= (1 << role);
     }
 
-    return (nRoots > 0) && (nThirds > 0) && (nFifths > 0);
+    // triads need 1, 3, 5. seventh chords need 1, 3, 7
+    const int required = options.keysig->requiredChordRoles(root, options.style->getSeventhChords());
+    return (rolesPresent & required) == required;
 }
 
-bool Chord4::isCorrectDoubling(const Options& options) const {
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::isCorrectDoubling(const Options& options) const {
     assert(isAcceptableDoubling(options));
 
     bool ret;
     int nVoice;
-    int nRoots, nThirds, nFifths;
     int nDoubled = 0;
+    int count[8] = {0};  // how many of each chord role (1, 3, 5, 7)
 
 #if 0
     if (this->toStringShort() == "E2G2C3E3") {
@@ -412,29 +463,40 @@ bool Chord4::isCorrectDoubling(const Options& options) const {
     }
 #endif
 
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
 
-    for (nVoice = nRoots = nThirds = nFifths = 0; nVoice < CHORD_SIZE; nVoice++)  // loop over all notes in chord
+    for (nVoice = 0; nVoice < NUM_VOICES; nVoice++)  // loop over all notes in chord
     {
-        switch (chordInterval(options, _notes[nVoice])) {
-            case 1:
-                nRoots++;
-                if (nRoots > 1) nDoubled = nVoice;
-                break;
-            case 3:
-                nThirds++;
-                if (nThirds > 1) nDoubled = nVoice;
-                break;
-            case 5:
-                nFifths++;
-                if (nFifths > 1) nDoubled = nVoice;
-                break;
+        const int role = chordInterval(options, _notes[nVoice]);
+        if (++count[role] > 1) nDoubled = nVoice;
+    }
+    const int nRoots = count[1];
+    const int nThirds = count[3];
+    const int nFifths = count[5];
+    const int nSevenths = count[7];
+
+    // three voices have nothing to double - any complete triad is correct.
+    if (NUM_VOICES == 3) {
+        return true;
+    }
+
+    if (options.style->getSeventhChords()) {
+        // never double the third or the seventh. In root position the fifth
+        // may be left out for a doubled root, inversions must be complete.
+        ret = (nThirds == 1) && (nSevenths <= 1);
+        if (inversion(options) == ROOT_POS_INVERSION) {
+            ret = ret && (nRoots >= nFifths);
+        } else {
+            ret = ret && (nFifths > 0);
         }
+        return ret;
     }
 
+    // These reduce to the classic SATB rules for four voices. Five and six voices
+    // have more than one doubling, so they only restrict what must not be doubled.
     switch (inversion(options)) {
         case ROOT_POS_INVERSION:
-            ret = (nRoots == 2) && (nThirds == 1) && (nFifths == 1);
+            ret = (nThirds == 1) && (nRoots >= nFifths);
             // double root
             // Note: some people say it's ok to double the root or the fifth
             break;
@@ -442,7 +504,7 @@ bool Chord4::isCorrectDoubling(const Options& options) const {
             // srn should be made already
             // makeSrnNotes(options);           // fill up the srnNotes array with valid stuff
             if (srnNotes[BASS].isTonal()) {  // if the bass is tonal
-                ret = (nRoots == 1) && (nThirds == 2) && (nFifths == 1);
+                ret = (nThirds == 2);
                 // then double the bass (3rd)
             } else {                                   // if bass not tonal...
                 ret = srnNotes[nDoubled].isTonal() &&  // double tonal
@@ -451,7 +513,7 @@ bool Chord4::isCorrectDoubling(const Options& options) const {
             }
             break;
         case SECOND_INVERSION:
-            ret = (nFifths == 2);
+            ret = (nFifths >= 2);
             break;
         default:
             static bool shown = false;
@@ -466,7 +528,8 @@ bool Chord4::isCorrectDoubling(const Options& options) const {
 }
 
 #if 0
-bool Chord4::isStdDoubling(const Options& options) {
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::isStdDoubling(const Options& options) {
     bool ret;
     int nVoice;
     int nRoots, nThirds, nFifths;
@@ -478,9 +541,9 @@ bool Chord4::isStdDoubling(const Options& options) {
     }
 #endif
 
-    assert(_notes.size() == CHORD_SIZE);
+    assert(_notes.size() == NUM_VOICES);
 
-    for (nVoice = nRoots = nThirds = nFifths = 0; nVoice < CHORD_SIZE; nVoice++)  // loop over all notes in chord
+    for (nVoice = nRoots = nThirds = nFifths = 0; nVoice < NUM_VOICES; nVoice++)  // loop over all notes in chord
     {
         switch (chordInterval(options, _notes[nVoice])) {
             case 1:
@@ -529,36 +592,24 @@ bool Chord4::isStdDoubling(const Options& options) {
 
 /* ChordRelativeNote Chord4::ChordInterval(Note note)
  */
-ChordRelativeNote Chord4::chordInterval(const Options& options, HarmonyNote note) const {
-    // static int dumb = -1;
-    int nt = 0;  // assume bogus
+template <int NUM_VOICES>
+ChordRelativeNote ChordN<NUM_VOICES>::chordInterval(const Options& options, HarmonyNote note) const {
     ChordRelativeNote ret;
 
-    ScaleRelativeNote srnN;
-
-    srnN = options.keysig->ScaleDeg(note);  // get scale degree
-    if (srnN.isValid()) {
-        nt = 1 + srnN - root;  // to go from scale rel to chord rel, just normalize to chord root
-        if (nt <= 0) nt += 7;  // keep positive!
-    }
-    ret.set(nt);
+    // the keysig has a table of chord roles for every root, so this is just a lookup
+    const int pc = PitchClassSet::pitchClass(note);
+    ret.set(options.keysig->chordRole(root, options.style->getSeventhChords(), pc));
     return ret;
 }
 
 /* bool Chord4::InChord(Note test)
  */
-bool Chord4::isInChord(const Options& options, HarmonyNote test) const {
-    bool ret = false;
-
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::isInChord(const Options& options, HarmonyNote test) const {
     // const bool b = (this->toStringShort() == "E2A2C3A3");
 
-    const ChordRelativeNote crnX = chordInterval(options, test);
-    switch (crnX) {
-        case 1:
-        case 3:
-        case 5:
-            ret = true;
-    }
+    const PitchClassSet chordTones = options.keysig->chordPitchClasses(root, options.style->getSeventhChords());
+    const bool ret = chordTones.contains(PitchClassSet::pitchClass(test));
 #if 0
     if (b) {
         printf("here is note at isInChord, will ret %d\n", ret);
@@ -571,7 +622,8 @@ bool Chord4::isInChord(const Options& options, HarmonyNote test) const {
 /* int Chord4::Inversion()
 
  */
-INVERSION Chord4::inversion(const Options& options) const {
+template <int NUM_VOICES>
+INVERSION ChordN<NUM_VOICES>::inversion(const Options& options) const {
     // static int dumb = -1;
     INVERSION ret;
 
@@ -585,6 +637,9 @@ INVERSION Chord4::inversion(const Options& options) const {
         case 5:
             ret = SECOND_INVERSION;
             break;
+        case 7:
+            ret = THIRD_INVERSION;
+            break;
         default:
             ret = NO_INVERSION;
     }
@@ -601,7 +656,8 @@ if (notes[0] != dumb)
 /* bool Chord4::CanFollowThisGuy(const Chord4 * const ThisGuy) const;
  */
 #if 0
-bool Chord4::canFollowThisGuy(const Options& options, const Chord4& thisGuy) const {
+template <int NUM_VOICES>
+bool ChordN<NUM_VOICES>::canFollowThisGuy(const Options& options, const Chord4& thisGuy) const {
     ProgressionAnalyzer analyzer(thisGuy, *this, false);
 
     assert(false);
@@ -610,12 +666,18 @@ bool Chord4::canFollowThisGuy(const Options& options, const Chord4& thisGuy) con
 }
 #endif
 
-int Chord4::penaltForFollowingThisGuy(const Options& options, int lowestPenaltySoFar, const Chord4* thisGuy, bool show) const {
+template <int NUM_VOICES>
+int ChordN<NUM_VOICES>::penaltForFollowingThisGuy(const Options& options, int lowestPenaltySoFar, const ChordN* thisGuy, bool show) const {
     assert(valid);
     assert(thisGuy->valid);
     if (show) {
         SQINFO("enter Chord4::penaltForFollowingThisGuy");
     }
-    ProgressionAnalyzer analyzer(thisGuy, this, show);
+    ProgressionAnalyzerN<NUM_VOICES> analyzer(thisGuy, this, show);
     return analyzer.getPenalty(options, lowestPenaltySoFar);
 }
+
+template class ChordN<3>;
+template class ChordN<4>;
+template class ChordN<5>;
+template class ChordN<6>;
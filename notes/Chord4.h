@@ -4,12 +4,14 @@
 #pragma once
 
 #include <assert.h>
+#include <stdint.h>
 
 #include <memory>
 #include <vector>
 
 #include "ChordRelativeNote.h"
 #include "HarmonyNote.h"
+#include "PitchKnowledge.h"
 #include "ScaleRelativeNote.h"
 
 /**
@@ -51,15 +53,27 @@
  *
  */
 
-#define CHORD_SIZE 4
 #define OCTAVE_SPAN 1
 
 extern int __numChord4;
 
 class Options;
+
+/**
+ * ChordN is templated on the number of voices, so that
+ * three, four, five and six part writing all use the same engine.
+ * The voice loops all have a compile time trip count, so they unroll.
+ *
+ * Chord4 (four part writing) is the original, and still the one the modules use.
+ */
+template <int NUM_VOICES>
+class ChordN;
+
+using Chord4 = ChordN<4>;
 using Chord4Ptr = std::shared_ptr<Chord4>;
 using ConstChord4Ptr = std::shared_ptr<const Chord4>;
 
+// for other than four voices, the top voice is always the soprano
 enum VOICE_NAME { BASS,
                   TENOR,
                   ALTO,
@@ -68,37 +82,65 @@ enum VOICE_NAME { BASS,
 enum INVERSION { ROOT_POS_INVERSION,
                  FIRST_INVERSION,
                  SECOND_INVERSION,
+                 THIRD_INVERSION,  // seventh in the bass
                  NO_INVERSION };
 
-class Chord4 {
+template <int NUM_VOICES>
+class ChordN {
 public:
-    Chord4(const Options& options, int nDegree);  // pass scale degree in constructor
+    static_assert(NUM_VOICES >= 3 && NUM_VOICES <= 6, "only 3..6 part writing supported");
+    static const int numVoices = NUM_VOICES;
+    using ChordNPtr = std::shared_ptr<ChordN>;
+
+    /**
+     * All the pitches of a voicing in one integer, 8 bits per voice, bass in the low byte.
+     * Cheap to compare and hash, so voicings can be looked up without making strings.
+     */
+    using Packed = uint64_t;
+    static Packed pack(const int* pitches);
+    static int unpack(Packed packed, int voice) {
+        return int((packed >> (8 * voice)) & 0xff);
+    }
+    Packed packed() const;
+
+    ChordN(const Options& options, int nDegree);  // pass scale degree in constructor
                                                   // This construct will advance us to valid guy
 
-    bool operator==(const Chord4& that) const {
+    bool operator==(const ChordN& that) const {
         return _notes == that._notes;
     }
     // TODO: get rid of this default ctor
-    Chord4();
-    ~Chord4();
+    ChordN();
+    ~ChordN();
 
     /**
      * @brief makes a specific string, ex "E2A2C3A3", BUT:
      *      it can only do this if the chord is "legal" according to options
-     *      it is not super fast.
      *
-     * @return Chord4Ptr
+     * @return ChordNPtr, or nullptr if the string is malformed or the chord isn't legal.
      */
-    static Chord4Ptr fromString(const Options& options, int degree, const char*);
+    static ChordNPtr fromString(const Options& options, int degree, const char*);
+
+    /**
+     * @brief same as fromString, for a voicing that is already parsed.
+     * Checks that the voicing is legal, but doesn't search for it.
+     */
+    static ChordNPtr fromPacked(const Options& options, int degree, Packed voicing);
+
+    /**
+     * @brief parses a string like "E2A2C3A3" into pitches.
+     * @return false if the string isn't exactly NUM_VOICES pitches.
+     */
+    static bool parse(const char* str, Packed& outVoicing);
 
     bool makeNext(const Options& op);  // returns false if made another one, true if could not
     void print() const;
     int quality(const Options& options, bool fTalk) const;  // tell how "good" this chord is
                                                             // if ftalk is true, will tell why
 
-    int penaltForFollowingThisGuy(const Options&, int lowestPenaltySoFar, const Chord4* ThisGuy, bool show) const;
+    int penaltForFollowingThisGuy(const Options&, int lowestPenaltySoFar, const ChordN* ThisGuy, bool show) const;
 
-    const HarmonyNote* fetchNotes() const;  // This returns pointer so you can get at all 4
+    const HarmonyNote* fetchNotes() const;  // This returns pointer so you can get at all of them
     const ScaleRelativeNote* fetchSRNNotes() const;
     bool isInChord(const Options& op, HarmonyNote test) const;  // Tells if a note pitch is valid note in this chord
     int fetchRoot() const;                                      // tell root of chord
@@ -110,6 +152,14 @@ public:
     std::string toString() const { return getString(); }
     std::string toStringShort() const;
 
+    /**
+     * @brief same as toStringShort, but doesn't allocate.
+     * @param buffer must hold at least maxStringLength + 1 chars.
+     * @return int is the length of the string.
+     */
+    int format(char* buffer) const;
+    static const int maxStringLength = NUM_VOICES * PitchKnowledge::maxNameLength;
+
     bool isAcceptableDoubling(const Options& option) const;
     bool isCorrectDoubling(const Options& option) const;
 
@@ -117,10 +167,11 @@ public:
 
 private:
     // friend ChordList;  // so he can "construct" us
+    ChordN(const Options& options, int nDegree, Packed voicing);  // for fromPacked. may not be valid
 
     bool isChordOk(const Options&) const;  // Tells if the current chord is "good"
     bool pitchesInRange(const Options&) const;
-    ChordRelativeNote chordInterval(const Options&, HarmonyNote) const;  // converts from scale rel to chord rel
+    ChordRelativeNote chordInterval(const Options&, HarmonyNote) const;  // chord role of a pitch: 1, 3, 5, 7 or 0 if not in chord
 
     bool inc(const Options&);  // go to next chord (valid or not), return true if can't
 
@@ -141,24 +192,27 @@ private:
     // **** guys who allocate storage ******
     // static int size;
 
-    ScaleRelativeNote srnNotes[CHORD_SIZE];  // After MakeNext is called, these will be valid
+    ScaleRelativeNote srnNotes[NUM_VOICES];  // After MakeNext is called, these will be valid
                                              //   used for analysis
 
-    int root = 1;  // 1..8 1 = chord is tonic, 5 = dominant, etc..
+    int root = 1;  // 1..numDegrees 1 = chord is tonic, 5 = dominant, etc..
                    // is scale relative
     std::vector<HarmonyNote> _notes;
     bool valid = false;
 };
 
-inline int Chord4::fetchRoot() const {
+template <int NUM_VOICES>
+inline int ChordN<NUM_VOICES>::fetchRoot() const {
     return root;
 }
 
-inline const HarmonyNote* Chord4::fetchNotes() const {
-    assert(_notes.size() == 4);
+template <int NUM_VOICES>
+inline const HarmonyNote* ChordN<NUM_VOICES>::fetchNotes() const {
+    assert(_notes.size() == NUM_VOICES);
     return _notes.data();
 }
 
-inline const ScaleRelativeNote* Chord4::fetchSRNNotes() const {
+template <int NUM_VOICES>
+inline const ScaleRelativeNote* ChordN<NUM_VOICES>::fetchSRNNotes() const {
     return srnNotes;
 }
@@ -5,7 +5,8 @@
 
 #include "SqLog.h"
 
-static int compareChords(const Options& options, Chord4Ptr ch1, Chord4Ptr ch2) {
+template <class TChordPtr>
+static int compareChords(const Options& options, TChordPtr ch1, TChordPtr ch2) {
 
     const int q1 = ch1->quality(options, false);
     const int q2 = ch2->quality(options, false);
@@ -13,11 +14,12 @@ static int compareChords(const Options& options, Chord4Ptr ch1, Chord4Ptr ch2) {
     return q1 > q2;
 }
 
-Chord4List::Chord4List(const Options& options, int rt) {
-    Chord4 C2(options, rt);
+template <int NUM_VOICES>
+ChordNList<NUM_VOICES>::ChordNList(const Options& options, int rt) {
+    Chord C2(options, rt);
     for (bool done=false; !done; ) {
        // Chord4Ptr newChord = std::make_shared<Chord4>(C2);
-        Chord4Ptr newChord = std::make_shared<Chord4>();
+        ChordPtr newChord = std::make_shared<Chord>();
         *newChord = C2;
        // assert(newChord->isValid());
         if (!newChord->isValid()) {
@@ -29,7 +31,19 @@ Chord4List::Chord4List(const Options& options, int rt) {
         done = C2.makeNext(options);  // advance to next chord
     }
     assert(!chords.empty());        // in theory ok, but don't know if we handle it.
-    std::sort(chords.begin(), chords.end(), [options](Chord4Ptr  c1, Chord4Ptr  c2) {
+    std::sort(chords.begin(), chords.end(), [options](ChordPtr  c1, ChordPtr  c2) {
             return compareChords(options, c1, c2);
     });
+
+    index.reserve(chords.size());
+    voicings.reserve(chords.size());
+    for (int i = 0; i < int(chords.size()); ++i) {
+        index[chords[i]->packed()] = i;
+        voicings.push_back(chords[i]->packed());
+    }
 }
+
+template class ChordNList<3>;
+template class ChordNList<4>;
+template class ChordNList<5>;
+template class ChordNList<6>;
@@ -1,32 +1,64 @@
-
 #pragma once
 
 #include <assert.h>
 
+#include <unordered_map>
 #include <vector>
 
 #include "Chord4.h"
 
-class Chord4List {
+/**
+ * All the legal voicings for one root, sorted by quality.
+ */
+template <int NUM_VOICES>
+class ChordNList {
 public:
-    Chord4List(const Options& options, int root);
+    using Chord = ChordN<NUM_VOICES>;
+    using ChordPtr = std::shared_ptr<Chord>;
+    using Packed = typename Chord::Packed;
+
+    ChordNList(const Options& options, int root);
 
     int size() const;  // how many chords are in list
 
     // If there is an error constructing chords, this is how we signal it.
     bool isValid() const { return !chords.empty(); }
 
-    const Chord4* get2(int n) const;
+    const Chord* get2(int n) const;
+
+    /**
+     * @brief find a voicing in the list.
+     * @return int is the index for get2, or -1 if this voicing isn't in the list.
+     */
+    int find(Packed voicing) const;
+
+    /**
+     * @return all the voicings, packed, in the same order as get2.
+     * Contiguous, so scanning them is fast.
+     */
+    const Packed* packedVoicings() const { return voicings.data(); }
 
 private:
-    std::vector<Chord4Ptr> chords;
+    std::vector<ChordPtr> chords;
+    std::vector<Packed> voicings;
+
+    // packed voicing -> index in chords
+    std::unordered_map<Packed, int> index;
 };
 
-inline int Chord4List::size() const {
+template <int NUM_VOICES>
+inline int ChordNList<NUM_VOICES>::find(Packed voicing) const {
+    auto it = index.find(voicing);
+    return (it == index.end()) ? -1 : it->second;
+}
+
+template <int NUM_VOICES>
+inline int ChordNList<NUM_VOICES>::size() const {
     return chords.size();
 }
 
-inline const Chord4* Chord4List::get2(int n) const {
+template <int NUM_VOICES>
+inline const ChordN<NUM_VOICES>* ChordNList<NUM_VOICES>::get2(int n) const {
     assert(isValid());
     if (!isValid()) {
         return nullptr;
@@ -38,4 +70,6 @@ inline const Chord4* Chord4List::get2(int n) const {
     assert(n < size());
     return chords[n].get();
 }
+
+using Chord4List = ChordNList<4>;
 using Chord4ListPtr = std::shared_ptr<Chord4List>;
@@ -1,17 +1,30 @@
 #pragma once
 
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
 
 #include "Chord4.h"
 #include "Chord4List.h"
+#include "KeysigOld.h"
+#include "Options.h"
 
-using Chord4ListPtr = std::shared_ptr<Chord4List>;
-class Chord4Manager {
+/**
+ * Holds a ChordNList for every root, 1..numDegrees of the current scale.
+ */
+template <int NUM_VOICES>
+class ChordNManager {
 public:
-    Chord4Manager(const Options& options) {
-        for (int i = 0; i < 10; ++i) {
-            if (i > 0 && i < 8) {
-                auto newChord = std::make_shared<Chord4List>(options, i);
+    using Chord = ChordN<NUM_VOICES>;
+    using ChordList = ChordNList<NUM_VOICES>;
+    using ChordListPtr = std::shared_ptr<ChordList>;
+    using Packed = typename Chord::Packed;
+
+    ChordNManager(const Options& options) {
+        const int numRoots = options.keysig->numDegrees();
+        for (int i = 0; i < numChordLists; ++i) {
+            if (i > 0 && i <= numRoots) {
+                auto newChord = std::make_shared<ChordList>(options, i);
                 if (!newChord->isValid()) {
                     chords.clear();
                     assert(chords.empty());
@@ -24,15 +37,62 @@ public:
                 chords.push_back(nullptr);
             }
         }
+        buildSopranoIndex();
+        buildRecognitionIndex(options);
+    }
+
+    /**
+     * A voicing in the manager, by root and rank.
+     */
+    class VoicingRef {
+    public:
+        int root = 0;
+        int rank = 0;
+    };
+
+    /**
+     * All the voicings, in every root, whose top voice is sopranoPitch.
+     * Ordered by rank, then by root.
+     * @param sopranoPitch is a HarmonyNote pitch.
+     * @return number of voicings. refs is set to the first one.
+     */
+    int withSoprano(int sopranoPitch, const VoicingRef*& refs) const {
+        refs = nullptr;
+        if (sopranoPitch < 0 || sopranoPitch >= numPitches) {
+            return 0;
+        }
+        const int first = sopranoStart[sopranoPitch];
+        refs = sopranoRefs.data() + first;
+        return sopranoStart[sopranoPitch + 1] - first;
+    }
+
+    /**
+     * @return the pitch class of sopranoPitch that is nearest to it and has voicings,
+     * or -1 if there aren't any.
+     */
+    int closestSoprano(int sopranoPitch) const {
+        const VoicingRef* unused;
+        for (int octaves = 0; octaves < numPitches / 12 + 1; ++octaves) {
+            const int down = sopranoPitch - 12 * octaves;
+            const int up = sopranoPitch + 12 * octaves;
+            if (withSoprano(down, unused)) {
+                return down;
+            }
+            if (withSoprano(up, unused)) {
+                return up;
+            }
+        }
+        return -1;
     }
 
     bool isValid() const { return !chords.empty(); }
     int size(int root) const {
-        assert(chords.size() == 10);
+        assert(int(chords.size()) == numChordLists);
+        assert(chords[root]);
         return chords[root]->size();
     }
 #if 0  // dangerous
-    const Chord4& get(int root, int rank) const {
+    const Chord& get(int root, int rank) const {
         assert(!chords.empty());
         assert (root < int(chords.size()));
         return chords[root]->get(rank);
@@ -40,26 +100,210 @@ public:
 #endif
 
     // same as get, but can return "not found" (nullptr)
-    const Chord4* get2(int root, int rank) const {
+    const Chord* get2(int root, int rank) const {
         assert(isValid());
         if (!isValid()) {
             return nullptr;
         }
-        if (root >= int(chords.size())) {
+        if (root >= int(chords.size()) || !chords[root]) {
             return nullptr;
         }
 
         return chords[root]->get2(rank);
     }
 
+    // all the voicings for a root, packed, in rank order
+    const Packed* packedVoicings(int root) const {
+        assert(isValid());
+        assert(chords[root]);
+        return chords[root]->packedVoicings();
+    }
+
+    /**
+     * @brief O(1) lookup of a voicing.
+     * @return int is the rank for get2, or -1 if the voicing isn't a legal chord on this root.
+     */
+    int find(int root, Packed voicing) const {
+        assert(isValid());
+        if (root < 1 || root >= int(chords.size()) || !chords[root]) {
+            return -1;
+        }
+        return chords[root]->find(voicing);
+    }
+
+    // same, from a string like "E2A2C3A3"
+    const Chord* find(int root, const char* str) const {
+        Packed voicing;
+        if (!Chord::parse(str, voicing)) {
+            return nullptr;
+        }
+        const int rank = find(root, voicing);
+        return (rank < 0) ? nullptr : get2(root, rank);
+    }
+
+    /**
+     * What chord some pitches make, in this key.
+     */
+    class Recognized {
+    public:
+        int root = 0;       // 1..numDegrees, 0 if the pitches aren't a chord in this key
+        int inversion = 0;  // 0 = root position, 1 = first, 2 = second, 3 = third
+        int doubled = 0;    // chord role (1, 3, 5, 7) that has the most voices, 0 if none doubled
+        int rank = -1;      // rank for get2, -1 if this voicing isn't in our tables
+    };
+
+    /**
+     * @brief recognize a voicing from its pitches. O(1) - a sort of NUM_VOICES notes,
+     * one hash lookup, and one table lookup if the voicing isn't one of ours
+     * (ex: out of range, or a doubling the style doesn't allow).
+     *
+     * @param pitches is NUM_VOICES HarmonyNote pitches, in any order.
+     */
+    Recognized recognize(const int* pitches) const {
+        assert(isValid());
+        int sorted[NUM_VOICES];
+        std::copy(pitches, pitches + NUM_VOICES, sorted);
+        std::sort(sorted, sorted + NUM_VOICES);
+
+        Recognized ret;
+        unsigned mask = 0;
+        for (int i = 0; i < NUM_VOICES; ++i) {
+            if (sorted[i] < 0 || sorted[i] >= numPitches) {
+                return ret;
+            }
+            mask |= 1 << PitchClassSet::pitchClass(sorted[i]);
+        }
+        auto it = voicingIndex.find(Chord::pack(sorted));
+        if (it != voicingIndex.end()) {
+            ret.root = it->second.root;
+            ret.rank = it->second.rank;
+        } else {
+            ret.root = rootOfPitchClasses[mask];
+            if (!ret.root) {
+                return ret;
+            }
+        }
+
+        int roleCount[8] = {0};
+        for (int i = 0; i < NUM_VOICES; ++i) {
+            roleCount[chordRoles[ret.root][PitchClassSet::pitchClass(sorted[i])]]++;
+        }
+        const int bassRole = chordRoles[ret.root][PitchClassSet::pitchClass(sorted[0])];
+        ret.inversion = (bassRole - 1) / 2;  // 1, 3, 5, 7 -> 0, 1, 2, 3
+        int most = 1;
+        for (int role = 1; role < 8; role += 2) {
+            if (roleCount[role] > most) {
+                most = roleCount[role];
+                ret.doubled = role;
+            }
+        }
+        return ret;
+    }
+
     int _size() const {
         return chords[1]->size();
     }
 
 private:
+    static const int numChordLists = KeysigOld::maxDegrees + 1;
+    static const int numPitches = 128;
+
+    void buildSopranoIndex() {
+        if (!isValid()) {
+            return;
+        }
+        // counting sort by soprano pitch, so each pitch is one contiguous run.
+        int counts[numPitches] = {0};
+        forEachVoicing([&counts](int root, int rank, int soprano) {
+            counts[soprano]++;
+        });
+        sopranoStart[0] = 0;
+        for (int i = 0; i < numPitches; ++i) {
+            sopranoStart[i + 1] = sopranoStart[i] + counts[i];
+        }
+        sopranoRefs.resize(sopranoStart[numPitches]);
+        int next[numPitches];
+        std::copy(sopranoStart, sopranoStart + numPitches, next);
+        forEachVoicing([this, &next](int root, int rank, int soprano) {
+            VoicingRef& ref = sopranoRefs[next[soprano]++];
+            ref.root = root;
+            ref.rank = rank;
+        });
+    }
+
+    // Builds voicingIndex, packed voicing -> (root, rank) for every voicing we have,
+    // and rootOfPitchClasses, pitch class mask -> root, for the ones we don't.
+    void buildRecognitionIndex(const Options& options) {
+        if (!isValid()) {
+            return;
+        }
+        forEachVoicing([this](int root, int rank, int soprano) {
+            VoicingRef& ref = voicingIndex[chords[root]->get2(rank)->packed()];
+            ref.root = root;
+            ref.rank = rank;
+        });
+
+        // Fallback for voicings we don't have: any voicing with all the pitch classes
+        // of a chord, and only those, is that chord.
+        const bool seventh = options.style->getSeventhChords();
+        for (int root = 1; root <= options.keysig->numDegrees(); ++root) {
+            const unsigned full = options.keysig->chordPitchClasses(root, seventh).get();
+            const int required = options.keysig->requiredChordRoles(root, seventh);
+            unsigned optional = 0;
+            for (int pc = 0; pc < 12; ++pc) {
+                const int role = options.keysig->chordRole(root, seventh, pc);
+                chordRoles[root][pc] = role;
+                if (role && !(required & (1 << role))) {
+                    optional |= 1 << pc;
+                }
+            }
+            // every subset of the optional tones may be left out.
+            for (unsigned leftOut = optional;; leftOut = (leftOut - 1) & optional) {
+                rootOfPitchClasses[full & ~leftOut] = root;
+                if (!leftOut) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Visits the best voicings of every root before the worse ones,
+    // so a search that stops at the first perfect chord stops early.
+    template <typename F>
+    void forEachVoicing(F f) const {
+        int maxSize = 0;
+        for (auto list : chords) {
+            if (list) {
+                maxSize = std::max(maxSize, list->size());
+            }
+        }
+        for (int rank = 0; rank < maxSize; ++rank) {
+            for (int root = 1; root < int(chords.size()); ++root) {
+                if (!chords[root] || rank >= chords[root]->size()) {
+                    continue;
+                }
+                const int soprano = chords[root]->get2(rank)->fetchNotes()[NUM_VOICES - 1];
+                assert(soprano >= 0 && soprano < numPitches);
+                f(root, rank, soprano);
+            }
+        }
+    }
+
     // entries for 0 = no=used, 1= root
     // Chord4Ptr p;
-    std::vector<Chord4ListPtr> chords;
+    std::vector<ChordListPtr> chords;
+
+    // sopranoRefs[sopranoStart[p]..sopranoStart[p+1]) have soprano pitch p
+    std::vector<VoicingRef> sopranoRefs;
+    int sopranoStart[numPitches + 1] = {0};
+
+    // packed voicing -> where it lives, for every root.
+    std::unordered_map<Packed, VoicingRef> voicingIndex;
+
+    // pitch class mask -> root, 0 if not a chord.
+    int8_t rootOfPitchClasses[1 << 12] = {0};
+    int8_t chordRoles[KeysigOld::maxDegrees + 1][12] = {{0}};
 };
 
+using Chord4Manager = ChordNManager<4>;
 using Chord4ManagerPtr = std::shared_ptr<Chord4Manager>;
@@ -1,7 +1,8 @@
 
 #pragma once
 
-class Chord4;
+template <int NUM_VOICES>
+class ChordN;
 
 class ChordRelativeNote {
 public:
@@ -10,7 +11,8 @@ public:
 
 private:
     int pitch;
-    friend Chord4;  // so he can set us
+    template <int NUM_VOICES>
+    friend class ChordN;  // so he can set us
     void set(int);  // I should be private!!!!!
 };
 
@@ -1,12 +1,20 @@
 #include "HarmonyChords.h"
 #include "ProgressionAnalyzer.h"
 
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "Chord4Manager.h"
 
-const Chord4* HarmonyChords::findChord(
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::findChord(
     bool show,
     const Options& options,
-    const Chord4Manager& manager,
+    const Manager& manager,
     int root) {
 
     //SQINFO("enter HarmonyChords::findChord");
@@ -22,7 +30,7 @@ const Chord4* HarmonyChords::findChord(
         if (rankToTry >= size) {
             return nullptr;
         }
-        const Chord4* chord = manager.get2(root, rankToTry);
+        const Chord* chord = manager.get2(root, rankToTry);
         assert(chord);
         assert(chord->isValid());
         //SQINFO("in find chord loop %s", chord->toString().c_str());
@@ -37,37 +45,40 @@ const Chord4* HarmonyChords::findChord(
     return nullptr;
 }
 
-const Chord4* HarmonyChords::findChord(
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::findChord(
     bool show,
     const Options& options,
-    const Chord4Manager& manager,
-    const Chord4& prev,
+    const Manager& manager,
+    const Chord& prev,
     int root) {
     return find(show, options, manager, nullptr, &prev, root);
 }
 
-const Chord4* HarmonyChords::findChord(
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::findChord(
     bool show,
     const Options& options,
-    const Chord4Manager& manager,
-    const Chord4& prevPrev,
-    const Chord4& prev,
+    const Manager& manager,
+    const Chord& prevPrev,
+    const Chord& prev,
     int root) {
-    const Chord4* ret = find(show, options, manager, &prevPrev, &prev, root);
+    const Chord* ret = find(show, options, manager, &prevPrev, &prev, root);
     assert(ret);        // we should always find something;
     return ret;
 }
 
-const Chord4* HarmonyChords::find(
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::find(
     bool show,
     const Options& options,
-    const Chord4Manager& manager,
-    const Chord4* prevPrev,
-    const Chord4* prev,
+    const Manager& manager,
+    const Chord* prevPrev,
+    const Chord* prev,
     int root) {
 
     assert(root > 0);
-    assert(root < 8);
+    assert(root <= options.keysig->numDegrees());
 #if 0
     if (prev && prevPrev) {
         printf("find called with prevOrev %s (root %d)\n", prevPrev->toString().c_str(), prevPrev->fetchRoot());
@@ -89,19 +100,23 @@ const Chord4* HarmonyChords::find(
     assert(!prev || (prev->fetchRoot() != root));  // should not have two rows in succession
     assert(!prevPrev || (prevPrev->fetchRoot() != prev->fetchRoot()));
 
+    if (prev && options.style->motionPenalty()) {
+        return findSmooth(show, options, manager, prevPrev, prev, root);
+    }
+
     const int size = manager.size(root);
     int rankToTry = 0;
     // printf("in find, rank start = %d, size=%d\n", rankToTry, size);
 
-    int lowestPenalty = ProgressionAnalyzer::MAX_PENALTY;
-    const Chord4* bestChord = nullptr;
+    int lowestPenalty = ProgressionAnalyzerN<NUM_VOICES>::MAX_PENALTY;
+    const Chord* bestChord = nullptr;
 
     for (bool done = false; !done; ++rankToTry) {
         if (rankToTry >= size) {
             done = true;
         }
         else {
-            const Chord4* currentChord = manager.get2(root, rankToTry);
+            const Chord* currentChord = manager.get2(root, rankToTry);
             const int currentPenalty = progressionPenalty(options, lowestPenalty, prevPrev, prev, currentChord, show);
             if (currentPenalty == 0) {
                 // printf("found penalty 0\n");
@@ -118,12 +133,248 @@ const Chord4* HarmonyChords::find(
     return bestChord;
 }
 
-int HarmonyChords::progressionPenalty(
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::findChordForMelody(
+    bool show,
+    const Options& options,
+    const Manager& manager,
+    const Chord* prevPrev,
+    const Chord* prev,
+    int sopranoPitch) {
+
+    assert(manager.isValid());
+    assert(prev || !prevPrev);
+    const typename Manager::VoicingRef* refs;
+    const int size = manager.withSoprano(sopranoPitch, refs);
+    if (size == 0) {
+        return nullptr;
+    }
+
+    if (!prev) {
+        // same rule as the first chord search.
+        for (int i = 0; i < size; ++i) {
+            const Chord* chord = manager.get2(refs[i].root, refs[i].rank);
+            if ((chord->inversion(options) == ROOT_POS_INVERSION) &&
+                (chord->isCorrectDoubling(options))) {
+                return chord;
+            }
+        }
+        return manager.get2(refs[0].root, refs[0].rank);
+    }
+
+    int lowestPenalty = ProgressionAnalyzerN<NUM_VOICES>::MAX_PENALTY;
+    const Chord* bestChord = nullptr;
+    for (int i = 0; i < size; ++i) {
+        // the analyzer expects the root to move. If the melody moves within
+        // one chord, we re-voice it only when no other root fits.
+        if (refs[i].root == prev->fetchRoot()) {
+            continue;
+        }
+        const Chord* currentChord = manager.get2(refs[i].root, refs[i].rank);
+        const int currentPenalty = progressionPenalty(options, lowestPenalty, prevPrev, prev, currentChord, show);
+        if (currentPenalty == 0) {
+            return currentChord;
+        }
+        if (currentPenalty < lowestPenalty) {
+            lowestPenalty = currentPenalty;
+            bestChord = currentChord;
+        }
+    }
+    if (!bestChord) {
+        bestChord = manager.get2(refs[0].root, refs[0].rank);
+    }
+    return bestChord;
+}
+
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::findPivotChord(
+    const Manager& newManager,
+    const Manager& oldManager,
+    const Chord& prev) {
+
+    assert(newManager.isValid());
+    assert(oldManager.isValid());
+    const Chord* bestChord = nullptr;
+    int leastMotion = 0;
+    for (int root = 1; newManager.get2(root, 0); ++root) {
+        for (int rank = 0; rank < newManager.size(root); ++rank) {
+            const Chord* chord = newManager.get2(root, rank);
+            const int motion = voiceMotion(prev, *chord);
+            if (bestChord && motion >= leastMotion) {
+                continue;
+            }
+            if (remap(oldManager, *chord)) {
+                bestChord = chord;
+                leastMotion = motion;
+            }
+        }
+    }
+    return bestChord;
+}
+
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::remap(const Manager& manager, const Chord& chord) {
+    int pitches[NUM_VOICES];
+    for (int i = 0; i < NUM_VOICES; ++i) {
+        pitches[i] = chord.fetchNotes()[i];
+    }
+    const auto recognized = manager.recognize(pitches);
+    return (recognized.rank < 0) ? nullptr : manager.get2(recognized.root, recognized.rank);
+}
+
+template <int NUM_VOICES>
+int HarmonyChordsN<NUM_VOICES>::voiceMotion(const Chord& a, const Chord& b) {
+    return voiceMotion(a.packed(), b.packed());
+}
+
+template <int NUM_VOICES>
+int HarmonyChordsN<NUM_VOICES>::voiceMotion(uint64_t a, uint64_t b) {
+    static_assert(NUM_VOICES <= 8, "packed voicings hold 8 voices");
+#if defined(__SSE2__)
+    // sum of absolute differences of the eight bytes. unused voices are zero in both.
+    const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&a));
+    const __m128i y = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&b));
+    const __m128i sad = _mm_sad_epu8(x, y);
+    return _mm_cvtsi128_si32(sad);
+#else
+    int ret = 0;
+    for (int i = 0; i < NUM_VOICES; ++i) {
+        ret += std::abs(Chord::unpack(a, i) - Chord::unpack(b, i));
+    }
+    return ret;
+#endif
+}
+
+template <int NUM_VOICES>
+int HarmonyChordsN<NUM_VOICES>::findAlternatives(
+    bool show,
+    const Options& options,
+    const Manager& manager,
+    const Chord* prevPrev,
+    const Chord* prev,
+    int root,
+    Alternatives& alternatives) {
+
+    assert(root > 0);
+    assert(root <= options.keysig->numDegrees());
+    assert(manager.isValid());
+    assert(prev || !prevPrev);
+    assert(!prev || (prev->fetchRoot() != root));
+    assert(!prevPrev || (prevPrev->fetchRoot() != prev->fetchRoot()));
+
+    alternatives.clear();
+    const int size = manager.size(root);
+    for (int rank = 0; rank < size; ++rank) {
+        if (alternatives.full() && alternatives.worstPenalty() == 0) {
+            break;      // can't do better than K perfect chords
+        }
+        const Chord* currentChord = manager.get2(root, rank);
+        if (!prev) {
+            // same rule as the first chord search: root position, nice doubling.
+            if ((currentChord->inversion(options) == ROOT_POS_INVERSION) &&
+                (currentChord->isCorrectDoubling(options))) {
+                alternatives.offer(currentChord, 0, rank);
+            }
+            continue;
+        }
+        const int bound = alternatives.full() ? alternatives.worstPenalty() : ProgressionAnalyzerN<NUM_VOICES>::MAX_PENALTY;
+        const int currentPenalty = progressionPenalty(options, bound, prevPrev, prev, currentChord, show);
+        if (currentPenalty < bound) {
+            alternatives.offer(currentChord, currentPenalty, rank);
+        }
+    }
+    alternatives.finish();
+    return alternatives.size();
+}
+
+template <int NUM_VOICES>
+void HarmonyChordsN<NUM_VOICES>::Alternatives::offer(const Chord* chord, int penalty, int rank) {
+    Entry entry;
+    entry.chord = chord;
+    entry.penalty = penalty;
+    entry.rank = rank;
+    if (count < capacity) {
+        entries[count++] = entry;
+        std::push_heap(entries, entries + count);
+    } else if (entry < entries[0]) {
+        std::pop_heap(entries, entries + count);
+        entries[count - 1] = entry;
+        std::push_heap(entries, entries + count);
+    }
+}
+
+template <int NUM_VOICES>
+void HarmonyChordsN<NUM_VOICES>::Alternatives::finish() {
+    std::sort_heap(entries, entries + count);
+}
+
+/**
+ * Score is rule penalty + motion penalty. The motion is so cheap to get from the
+ * packed voicings that we can afford to scan the list several times, looking at
+ * the chords that move the least first. Once the best score so far is less than
+ * the motion penalty of all the chords we haven't looked at we are done, and the
+ * progression analyzer never runs on most of the list.
+ */
+template <int NUM_VOICES>
+const ChordN<NUM_VOICES>* HarmonyChordsN<NUM_VOICES>::findSmooth(
+    bool show,
+    const Options& options,
+    const Manager& manager,
+    const Chord* prevPrev,
+    const Chord* prev,
+    int root) {
+
+    const int motionPenalty = options.style->motionPenalty();
+    const int size = manager.size(root);
+    const uint64_t* voicings = manager.packedVoicings(root);
+    const uint64_t from = prev->packed();
+
+    int minMotion = std::numeric_limits<int>::max();
+    int maxMotion = 0;
+    for (int rank = 0; rank < size; ++rank) {
+        const int motion = voiceMotion(from, voicings[rank]);
+        minMotion = std::min(minMotion, motion);
+        maxMotion = std::max(maxMotion, motion);
+    }
+
+    int lowestScore = std::numeric_limits<int>::max();
+    const Chord* bestChord = nullptr;
+
+    // each pass looks at the chords with motion in (done, limit]
+    int done = minMotion - 1;
+    int limit = minMotion;
+    for (int step = 1; (done < maxMotion) && ((done + 1) * motionPenalty < lowestScore); step *= 2) {
+        for (int rank = 0; rank < size; ++rank) {
+            const int motion = voiceMotion(from, voicings[rank]);
+            if (motion <= done || motion > limit) {
+                continue;
+            }
+            const int motionScore = motion * motionPenalty;
+            if (motionScore >= lowestScore) {
+                continue;
+            }
+            const Chord* currentChord = manager.get2(root, rank);
+            const int bound = std::min(lowestScore - motionScore, int(ProgressionAnalyzerN<NUM_VOICES>::MAX_PENALTY));
+            const int currentPenalty = progressionPenalty(options, bound, prevPrev, prev, currentChord, show);
+            if (currentPenalty >= bound) {
+                continue;
+            }
+            lowestScore = currentPenalty + motionScore;
+            bestChord = currentChord;
+        }
+        done = limit;
+        limit += step;
+    }
+    return bestChord;
+}
+
+template <int NUM_VOICES>
+int HarmonyChordsN<NUM_VOICES>::progressionPenalty(
     const Options& options,
     int bestSoFar,
-    const Chord4* prevPrev,
-    const Chord4* prev,
-    const Chord4* current,
+    const Chord* prevPrev,
+    const Chord* prev,
+    const Chord* current,
     bool show) {
     assert(current);
 
@@ -151,7 +402,12 @@ int HarmonyChords::progressionPenalty(
         printf("first = %s\n", prevPrev->toString().c_str());
         printf("second = %s\n", prev->toString().c_str());
         #endif
-        currentPenalty += ProgressionAnalyzer::PENALTY_FOR_REPEATED_CHORDS;
+        currentPenalty += ProgressionAnalyzerN<NUM_VOICES>::PENALTY_FOR_REPEATED_CHORDS;
     }
     return currentPenalty;
 }
+
+template class HarmonyChordsN<3>;
+template class HarmonyChordsN<4>;
+template class HarmonyChordsN<5>;
+template class HarmonyChordsN<6>;
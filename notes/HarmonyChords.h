@@ -1,15 +1,22 @@
 #pragma once
 
+#include <assert.h>
+#include <stdint.h>
+
 #include <memory>
 
-class Chord4;
+template <int NUM_VOICES>
+class ChordN;
+template <int NUM_VOICES>
+class ChordNManager;
 class Options;
-class Chord4Manager;
-
-using Chord4Ptr = std::shared_ptr<Chord4>;
 
-class HarmonyChords {
+template <int NUM_VOICES>
+class HarmonyChordsN {
 public:
+    using Chord = ChordN<NUM_VOICES>;
+    using Manager = ChordNManager<NUM_VOICES>;
+
     /**
      * @brief
      *
@@ -17,44 +24,165 @@ public:
      * @param manager
      * @param prev
      * @param root 1 = root, 2 = 2nd
-     * @return Chord4*. could be null.
+     * @return Chord*. could be null.
      *
      * caller does not "own" the chord returned, it is owned my manager
      */
-    static const Chord4* findChord(
+    static const Chord* findChord(
         bool show,
         const Options& options,
-        const Chord4Manager& manager,
-        const Chord4& prev,
+        const Manager& manager,
+        const Chord& prev,
         int root);
 
-    static const Chord4* findChord(
+    static const Chord* findChord(
         bool show,
         const Options& options,
-        const Chord4Manager& manager,
+        const Manager& manager,
         int root);
 
-    static const Chord4* findChord(
+    static const Chord* findChord(
         bool show,
         const Options& options,
-        const Chord4Manager& manager,
-        const Chord4& prevPrev,
-        const Chord4& prev,
+        const Manager& manager,
+        const Chord& prevPrev,
+        const Chord& prev,
         int root);
 
+    /**
+     * Melody harmonization: pick the root and voicing together, so that the
+     * top voice is sopranoPitch. Only voicings with that soprano are searched.
+     * @param prevPrev and @param prev may be null.
+     * @param sopranoPitch is a HarmonyNote pitch that manager has voicings for.
+     * @return Chord*. null if there are no voicings with this soprano.
+     * If only prev's root has this soprano, the result has the same root as prev,
+     * so it can't be the prev of a search.
+     */
+    static const Chord* findChordForMelody(
+        bool show,
+        const Options& options,
+        const Manager& manager,
+        const Chord* prevPrev,
+        const Chord* prev,
+        int sopranoPitch);
+
+    /**
+     * Key change: find the voicing in the new key that is also a voicing in the old key,
+     * and moves the least from prev.
+     * @param prev is a chord from the old key (from oldManager).
+     * @return Chord* from newManager. null if the keys have no voicings in common.
+     */
+    static const Chord* findPivotChord(
+        const Manager& newManager,
+        const Manager& oldManager,
+        const Chord& prev);
+
+    /**
+     * @return the same voicing in a different manager, ex: after a key change.
+     * null if it isn't a legal voicing there.
+     */
+    static const Chord* remap(const Manager& manager, const Chord& chord);
+
+    /**
+     * @return total movement, in semitones, of all the voices going from a to b.
+     */
+    static int voiceMotion(const Chord& a, const Chord& b);
+
+    // same, for packed voicings. One SSE2 instruction where we have it.
+    static int voiceMotion(uint64_t a, uint64_t b);
+
+    /**
+     * The K lowest penalty candidates from one search, best first.
+     * Fixed size, so searching never allocates.
+     */
+    class Alternatives {
+    public:
+        static const int maxSize = 8;
+
+        /**
+         * @param k is how many candidates to keep, 1..maxSize
+         */
+        explicit Alternatives(int k = maxSize) : capacity(k) {
+            assert(k > 0 && k <= maxSize);
+        }
+        int size() const { return count; }
+        const Chord* get(int index) const {
+            assert(index >= 0 && index < count);
+            return entries[index].chord;
+        }
+        int penalty(int index) const {
+            assert(index >= 0 && index < count);
+            return entries[index].penalty;
+        }
+
+    private:
+        friend class HarmonyChordsN;
+        class Entry {
+        public:
+            const Chord* chord = nullptr;
+            int penalty = 0;
+            int rank = 0;
+
+            // order by penalty, then by rank so the best one matches find().
+            bool operator<(const Entry& other) const {
+                return (penalty < other.penalty) || ((penalty == other.penalty) && (rank < other.rank));
+            }
+        };
+
+        /**
+         * While searching, entries[0..count) is a max-heap so the worst
+         * candidate is at the top. finish() turns it into a sorted list.
+         */
+        void clear() { count = 0; }
+        bool full() const { return count == capacity; }
+        int worstPenalty() const { return entries[0].penalty; }
+        void offer(const Chord* chord, int penalty, int rank);
+        void finish();
+
+        Entry entries[maxSize];
+        int count = 0;
+        const int capacity;
+    };
+
+    /**
+     * Like findChord, but keeps the best K voicings instead of just the best one.
+     * @param prevPrev and @param prev may be null.
+     * alternatives.get(0) is always the chord findChord would return.
+     * @return number of alternatives found.
+     */
+    static int findAlternatives(
+        bool show,
+        const Options& options,
+        const Manager& manager,
+        const Chord* prevPrev,
+        const Chord* prev,
+        int root,
+        Alternatives& alternatives);
+
     static int progressionPenalty(const Options& options,
                                   int bestSoFar,
-                                  const Chord4* prevProv,
-                                  const Chord4* prev,
-                                  const Chord4* current,
+                                  const Chord* prevProv,
+                                  const Chord* prev,
+                                  const Chord* current,
                                   bool show);
 
 private:
-    static const Chord4* find(
+    // find, for when the style wants smooth voice leading
+    static const Chord* findSmooth(
         bool show,
         const Options& options,
-        const Chord4Manager& manager,
-        const Chord4* prevProv,
-        const Chord4* prev,
+        const Manager& manager,
+        const Chord* prevProv,
+        const Chord* prev,
+        int root);
+
+    static const Chord* find(
+        bool show,
+        const Options& options,
+        const Manager& manager,
+        const Chord* prevProv,
+        const Chord* prev,
         int root);
 };
+
+using HarmonyChords = HarmonyChordsN<4>;
@@ -4,7 +4,9 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 #include "ProgressionAnalyzer.h"
 
@@ -45,6 +47,7 @@ HarmonySong::HarmonySong(const Options& options, const int* pS) : chordManager(o
         } else {
             auto ch = std::make_shared<RankedChord>(chordManager, pS[i]);
             chords.push_back(ch);
+            roots.push_back(pS[i]);
         }
     }
     // size = --i;
@@ -151,3 +154,329 @@ if (nStep == 0)		// if we are starting from top
     // if (nStep == 0) TRACE("Leaving Generate with return %d", ret);
     return ret;
 }
+
+namespace {
+/**
+ * One of the n best ways to get to a chord.
+ * pred and predK say which of the n best ways to the previous chord it came from.
+ */
+class PathEntry {
+public:
+    int penalty;
+    int16_t pred;
+    int16_t predK;
+};
+
+// candidate for the heap while merging. ordered so the heap top is the lowest penalty.
+class Candidate {
+public:
+    int penalty;
+    int16_t pred;
+    int16_t predK;
+    bool operator<(const Candidate& other) const {
+        return penalty > other.penalty;
+    }
+};
+}  // namespace
+
+std::vector<HarmonySong::Harmonization> HarmonySong::generateBest(const Options& options, int n, size_t& bytesUsed) const {
+    assert(n > 0);
+    const int numSteps = int(roots.size());
+    std::vector<Harmonization> ret;
+    bytesUsed = 0;
+    if (numSteps == 0) {
+        return ret;
+    }
+
+    // best[step][chord * n + k] is the k'th best way to get to a chord. count says how many there are.
+    std::vector<std::vector<PathEntry>> best(numSteps);
+    std::vector<std::vector<int16_t>> count(numSteps);
+    std::vector<Candidate> heap;
+
+    const int firstSize = chordManager.size(roots[0]);
+    best[0].resize(firstSize * n);
+    count[0].assign(firstSize, 1);
+    for (int chord = 0; chord < firstSize; ++chord) {
+        best[0][chord * n] = {0, -1, -1};
+    }
+
+    for (int step = 1; step < numSteps; ++step) {
+        const int prevSize = chordManager.size(roots[step - 1]);
+        const int size = chordManager.size(roots[step]);
+        assert(prevSize < 0x8000 && n < 0x8000);
+        const std::vector<int>& penalties = transitionPenalties(options, roots[step - 1], roots[step]);
+
+        best[step].resize(size * n);
+        count[step].assign(size, 0);
+        for (int chord = 0; chord < size; ++chord) {
+            // merge the sorted lists of all the previous chords, n deep.
+            heap.clear();
+            for (int prev = 0; prev < prevSize; ++prev) {
+                const int penalty = penalties[prev * size + chord];
+                if (count[step - 1][prev] && (penalty < ProgressionAnalyzer::MAX_PENALTY)) {
+                    heap.push_back({best[step - 1][prev * n].penalty + penalty, int16_t(prev), 0});
+                }
+            }
+            std::make_heap(heap.begin(), heap.end());
+            PathEntry* entries = &best[step][chord * n];
+            int16_t& found = count[step][chord];
+            while (!heap.empty() && found < n) {
+                std::pop_heap(heap.begin(), heap.end());
+                const Candidate c = heap.back();
+                heap.pop_back();
+                entries[found++] = {c.penalty, c.pred, c.predK};
+                if (c.predK + 1 < count[step - 1][c.pred]) {
+                    const int nextK = c.predK + 1;
+                    heap.push_back({best[step - 1][c.pred * n + nextK].penalty + penalties[c.pred * size + chord], c.pred, int16_t(nextK)});
+                    std::push_heap(heap.begin(), heap.end());
+                }
+            }
+        }
+    }
+
+    // same merge over all the chords of the last step, then follow the links back.
+    // here a candidate's pred is a chord in the last step.
+    const int lastStep = numSteps - 1;
+    const int lastSize = chordManager.size(roots[lastStep]);
+    heap.clear();
+    for (int chord = 0; chord < lastSize; ++chord) {
+        if (count[lastStep][chord]) {
+            heap.push_back({best[lastStep][chord * n].penalty, int16_t(chord), 0});
+        }
+    }
+    std::make_heap(heap.begin(), heap.end());
+    while (!heap.empty() && int(ret.size()) < n) {
+        std::pop_heap(heap.begin(), heap.end());
+        const Candidate c = heap.back();
+        heap.pop_back();
+
+        Harmonization h;
+        h.penalty = c.penalty;
+        h.ranks.resize(numSteps);
+        int chord = c.pred;
+        int k = c.predK;
+        for (int step = lastStep; step >= 0; --step) {
+            h.ranks[step] = chord;
+            const PathEntry& e = best[step][chord * n + k];
+            chord = e.pred;
+            k = e.predK;
+        }
+        ret.push_back(std::move(h));
+
+        if (c.predK + 1 < count[lastStep][c.pred]) {
+            const int nextK = c.predK + 1;
+            heap.push_back({best[lastStep][c.pred * n + nextK].penalty, c.pred, int16_t(nextK)});
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+
+    for (int step = 0; step < numSteps; ++step) {
+        bytesUsed += best[step].capacity() * sizeof(PathEntry) + count[step].capacity() * sizeof(int16_t);
+    }
+    for (auto& penalties : penaltiesFor) {
+        bytesUsed += penalties.capacity() * sizeof(int);
+    }
+    bytesUsed += heap.capacity() * sizeof(Candidate);
+    return ret;
+}
+
+void HarmonySong::use(const Harmonization& h) {
+    assert(h.ranks.size() == chords.size());
+    for (size_t i = 0; i < chords.size(); ++i) {
+        chords[i]->setRank(h.ranks[i]);
+    }
+}
+
+const std::vector<int>& HarmonySong::transitionPenalties(const Options& options, int prevRoot, int root) const {
+    const int numRoots = KeysigOld::maxDegrees + 1;
+    if (penaltiesFor.empty()) {
+        penaltiesFor.resize(numRoots * numRoots);
+    }
+    std::vector<int>& penalties = penaltiesFor[prevRoot * numRoots + root];
+    if (penalties.empty()) {
+        const int prevSize = chordManager.size(prevRoot);
+        const int size = chordManager.size(root);
+        penalties.resize(prevSize * size);
+        for (int prev = 0; prev < prevSize; ++prev) {
+            const Chord4* prevChord = chordManager.get2(prevRoot, prev);
+            for (int chord = 0; chord < size; ++chord) {
+                penalties[prev * size + chord] = chordManager.get2(root, chord)->penaltForFollowingThisGuy(options, ProgressionAnalyzer::MAX_PENALTY, prevChord, false);
+            }
+        }
+    }
+    return penalties;
+}
+
+static const int unreachable = std::numeric_limits<int>::max() / 2;
+
+/**
+ * @return true if new values are old values plus a constant, including which are unreachable.
+ */
+static bool sameUpToConstant(const std::vector<int>& a, const std::vector<int>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    bool first = true;
+    int delta = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if ((a[i] >= unreachable) != (b[i] >= unreachable)) {
+            return false;
+        }
+        if (a[i] >= unreachable) {
+            continue;
+        }
+        if (first) {
+            delta = a[i] - b[i];
+            first = false;
+        } else if (a[i] - b[i] != delta) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Search one step, from the step before it.
+ * @return true if the result changed by more than a constant, so the next step must be searched again.
+ */
+bool HarmonySong::searchForward(const Options& options, int step) {
+    ++stepsSearched;
+    const int size = chordManager.size(roots[step]);
+    std::vector<int> forward(size, 0);
+    std::vector<int16_t> from(size, -1);
+    if (step > 0) {
+        const Step& prev = steps[step - 1];
+        const int prevSize = int(prev.forward.size());
+        const std::vector<int>& penalties = transitionPenalties(options, roots[step - 1], roots[step]);
+        for (int chord = 0; chord < size; ++chord) {
+            int best = unreachable;
+            for (int p = 0; p < prevSize; ++p) {
+                const int penalty = penalties[p * size + chord];
+                if (penalty < ProgressionAnalyzer::MAX_PENALTY && prev.forward[p] + penalty < best) {
+                    best = prev.forward[p] + penalty;
+                    from[chord] = int16_t(p);
+                }
+            }
+            forward[chord] = best;
+        }
+    }
+    const bool changed = !sameUpToConstant(forward, steps[step].forward);
+    steps[step].forward = std::move(forward);
+    steps[step].from = std::move(from);
+    return changed;
+}
+
+bool HarmonySong::searchBackward(const Options& options, int step) {
+    ++stepsSearched;
+    const int size = chordManager.size(roots[step]);
+    std::vector<int> backward(size, 0);
+    std::vector<int16_t> to(size, -1);
+    if (step < int(steps.size()) - 1) {
+        const Step& next = steps[step + 1];
+        const int nextSize = int(next.backward.size());
+        const std::vector<int>& penalties = transitionPenalties(options, roots[step], roots[step + 1]);
+        for (int chord = 0; chord < size; ++chord) {
+            int best = unreachable;
+            for (int n = 0; n < nextSize; ++n) {
+                const int penalty = penalties[chord * nextSize + n];
+                if (penalty < ProgressionAnalyzer::MAX_PENALTY && next.backward[n] + penalty < best) {
+                    best = next.backward[n] + penalty;
+                    to[chord] = int16_t(n);
+                }
+            }
+            backward[chord] = best;
+        }
+    }
+    const bool changed = !sameUpToConstant(backward, steps[step].backward);
+    steps[step].backward = std::move(backward);
+    steps[step].to = std::move(to);
+    return changed;
+}
+
+/**
+ * Picks the best chord at step, then follows the links to the start and to the end.
+ * @return the total penalty of the song.
+ */
+int HarmonySong::followBestPath(const Options& options, int step) {
+    const Step& here = steps[step];
+    int bestRank = -1;
+    int best = unreachable;
+    for (int rank = 0; rank < int(here.forward.size()); ++rank) {
+        if (here.forward[rank] < unreachable && here.backward[rank] < unreachable &&
+            here.forward[rank] + here.backward[rank] < best) {
+            best = here.forward[rank] + here.backward[rank];
+            bestRank = rank;
+        }
+    }
+    if (bestRank < 0) {
+        return unreachable;
+    }
+
+    const int numSteps = int(steps.size());
+    std::vector<int> ranks(numSteps);
+    ranks[step] = bestRank;
+    for (int i = step; i > 0; --i) {
+        ranks[i - 1] = steps[i].from[ranks[i]];
+    }
+    for (int i = step; i < numSteps - 1; ++i) {
+        ranks[i + 1] = steps[i].to[ranks[i]];
+    }
+
+    // the stored penalties are off by a constant, so add them up for real.
+    int total = 0;
+    for (int i = 0; i < numSteps; ++i) {
+        chords[i]->setRank(ranks[i]);
+        if (i > 0) {
+            const int size = chordManager.size(roots[i]);
+            total += transitionPenalties(options, roots[i - 1], roots[i])[ranks[i - 1] * size + ranks[i]];
+        }
+    }
+    return total;
+}
+
+int HarmonySong::generateOptimal(const Options& options) {
+    const int numSteps = int(roots.size());
+    assert(numSteps > 0);
+    steps.clear();
+    steps.resize(numSteps);
+    stepsSearched = 0;
+    for (int step = 0; step < numSteps; ++step) {
+        searchForward(options, step);
+    }
+    for (int step = numSteps - 1; step >= 0; --step) {
+        searchBackward(options, step);
+    }
+    return followBestPath(options, numSteps - 1);
+}
+
+/**
+ * The steps before index only depend on the roots before it, so their forward search
+ * is still good. The same for the backward search after it. We search the other
+ * direction outward from the edit until a step comes out the same as before, up to
+ * a constant. From there on nothing changes.
+ */
+int HarmonySong::editRoot(const Options& options, int index, int root) {
+    const int numSteps = int(roots.size());
+    assert(index >= 0 && index < numSteps);
+    assert(int(steps.size()) == numSteps);
+    stepsSearched = 0;
+
+    roots[index] = root;
+    chords[index] = std::make_shared<RankedChord>(chordManager, root);
+    steps[index] = Step();
+
+    searchBackward(options, index);
+    for (int step = index - 1; step >= 0; --step) {
+        if (!searchBackward(options, step)) {
+            break;
+        }
+    }
+
+    searchForward(options, index);
+    for (int step = index + 1; step < numSteps; ++step) {
+        if (!searchForward(options, step)) {
+            break;
+        }
+    }
+    return followBestPath(options, index);
+}
@@ -27,9 +27,84 @@ public:
         return chords.size();
     }
     bool Generate(const Options& options, int Nlevel, bool show);  // ret true if ok!
+
+    /**
+     * One way to harmonize the song: the rank of the chord for every step.
+     * penalty is the sum of the progression penalties from one chord to the next.
+     */
+    class Harmonization {
+    public:
+        int penalty = 0;
+        std::vector<int> ranks;
+    };
+
+    /**
+     * @brief finds the n best distinct harmonizations, best first.
+     * Works on the whole lattice of chord transitions at once (k best Viterbi),
+     * so it doesn't have to search again for each one.
+     *
+     * @param bytesUsed is set to the memory used by the search.
+     * It is about (number of chords) * (chords per root) * n * 8 bytes, plus
+     * a table of (chords per root)^2 penalties for each pair of roots the song uses.
+     * @return may return fewer than n, if there aren't that many legal ones.
+     */
+    std::vector<Harmonization> generateBest(const Options& options, int n, size_t& bytesUsed) const;
+
+    // set the chords to one of the results of generateBest
+    void use(const Harmonization&);
+
+    /**
+     * @brief finds the best harmonization, and sets the chords to it.
+     * Keeps the search state, so that editRoot can be fast.
+     * @return the total penalty
+     */
+    int generateOptimal(const Options& options);
+
+    /**
+     * @brief change one root, and re-harmonize the song.
+     * Only the steps near the edit are searched again, usually a handful,
+     * no matter how long the song is.
+     * Must call generateOptimal first.
+     * @return the total penalty
+     */
+    int editRoot(const Options& options, int index, int root);
+
+    // how many steps the last generateOptimal or editRoot searched
+    int _stepsSearched() const { return stepsSearched; }
+
 private:
     // the final chords we make
     std::vector<std::shared_ptr<RankedChord>> chords;
+    std::vector<int> roots;
+
+    /**
+     * @return penalty for going from every chord of prevRoot to every chord of root,
+     * indexed by prevRank * size(root) + rank. Cached, since songs use the same root pairs over and over.
+     */
+    const std::vector<int>& transitionPenalties(const Options& options, int prevRoot, int root) const;
+    mutable std::vector<std::vector<int>> penaltiesFor;
+
+    /**
+     * Search state for generateOptimal and editRoot (Viterbi, both directions).
+     * forward[rank] is the penalty of the best way to get to this chord from the start of the song,
+     * and from[rank] is the rank of the chord before it on that way.
+     * backward and to are the same for the best way from this chord to the end.
+     * The values are only right up to a constant for each step, which doesn't matter
+     * for picking the best chords.
+     */
+    class Step {
+    public:
+        std::vector<int> forward;
+        std::vector<int16_t> from;
+        std::vector<int> backward;
+        std::vector<int16_t> to;
+    };
+    std::vector<Step> steps;
+    int stepsSearched = 0;
+
+    bool searchForward(const Options& options, int step);
+    bool searchBackward(const Options& options, int step);
+    int followBestPath(const Options& options, int step);
 
     Chord4Manager chordManager;
 
@@ -14,32 +14,76 @@ KeysigOld::KeysigOld(Roots rt) {
 
     // old one was always major
     scale->set(base, Scale::Scales::Major);
+    buildTables();
 }
 
 void KeysigOld::set(const MidiNote& basePitch, Scale::Scales mode) {
     // note that the ctor is 1 bases for pitch, this guy is zero based.
     scale->set(basePitch, mode);
+    buildTables();
+}
+
+void KeysigOld::buildTables() {
+    degrees = scale->numDegrees();
+    assert(degrees > 0 && degrees <= maxDegrees);
+
+    const int base = scale->base().get();
+    int pitchClassOfDegree[maxDegrees + 1] = {0};
+    for (int i = 0; i < 12; ++i) {
+        degreeOfPitchClass[i] = 0;
+    }
+    for (int degree = 1; degree <= degrees; ++degree) {
+        const int pc = (base + scale->degreeToSemitone(degree - 1)) % 12;
+        pitchClassOfDegree[degree] = pc;
+        degreeOfPitchClass[pc] = degree;
+    }
+    if (degrees == 7) {
+        leadingToneDegree = 7;
+        dominantDegree = 5;
+    } else {
+        leadingToneDegree = (degreeOfPitchClass[(base + 11) % 12] == degrees) ? degrees : 0;
+        dominantDegree = degreeOfPitchClass[(base + 7) % 12];
+    }
+
+    for (int seventh = 0; seventh < 2; ++seventh) {
+        const int numTones = seventh ? 4 : 3;
+        for (int root = 0; root <= maxDegrees; ++root) {
+            chordPcs[seventh][root] = PitchClassSet();
+            requiredRoles[seventh][root] = 0;
+            for (int i = 0; i < 12; ++i) {
+                chordRoles[seventh][root][i] = 0;
+            }
+            if (root < 1 || root > degrees) {
+                continue;
+            }
+            for (int tone = 0; tone < numTones; ++tone) {
+                const int role = 1 + 2 * tone;
+                const int degree = 1 + (root - 1 + 2 * tone) % degrees;
+                const int pc = pitchClassOfDegree[degree];
+
+                // in small scales a stacked tone can wrap around onto a lower one.
+                // lower chord tones win.
+                if (chordPcs[seventh][root].contains(pc)) {
+                    continue;
+                }
+                chordPcs[seventh][root].add(pc);
+                chordRoles[seventh][root][pc] = role;
+                if (!(seventh && (role == 5))) {
+                    requiredRoles[seventh][root] |= (1 << role);
+                }
+            }
+        }
+    }
 }
 
 std::pair<const MidiNote, Scale::Scales> KeysigOld::get() const {
    return scale->get();
 }
 
-ScaleRelativeNote KeysigOld::ScaleDeg(HarmonyNote pitch) {
-    const int midiPitch = pitch;
-    const MidiNote midiNote(midiPitch);
-    const ScaleNote scaleNote = scale->m2s(midiNote);
-
+ScaleRelativeNote KeysigOld::ScaleDeg(HarmonyNote pitch) const {
+    // if in scale it's 1..7, if not in a scale, it's zero
     ScaleRelativeNote ret;
-    if (scaleNote.isAccidental()) {
-        // if not in a scale, it's zero
-        ret.set(0);
-    }
-    else {
-        int degree = scaleNote.getDegree();
-        // if in scale it's 1..7
-        ret.set(degree + 1);
-    }
+    ret.set(degreeOfPitchClass[PitchClassSet::pitchClass(pitch)]);
     return ret;
 }
 
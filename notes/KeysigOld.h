@@ -1,6 +1,7 @@
 
 #pragma once
 #include "HarmonyNote.h"
+#include "PitchClassSet.h"
 #include "ScaleRelativeNote.h"
 //#include "ScaleQuantizer.h"
 #include "Scale.h"
@@ -25,8 +26,8 @@ class KeysigOld {
 public:
     // This [legacy] constructor always makes a major scale.
     // It could be fixed, but callin KeysigOld::set is easy.
-    ScaleRelativeNote ScaleDeg(HarmonyNote Pitch);  // converts a midi pitch to a Scale degree (1..8)
-                                                    // 0 for not a degree
+    ScaleRelativeNote ScaleDeg(HarmonyNote Pitch) const;  // converts a midi pitch to a Scale degree (1..8)
+                                                          // 0 for not a degree
     KeysigOld(Roots rt);
 
     void set(const MidiNote& basePitch, Scale::Scales scale);
@@ -36,8 +37,74 @@ public:
         return scale;
     }
 
+    static const int maxDegrees = 12;
+
+    /**
+     * @brief number of degrees in the current scale. 7 for the diatonic modes.
+     * Chord roots go from 1 to numDegrees().
+     */
+    int numDegrees() const { return degrees; }
+
+    /**
+     * Chords are made by stacking every other scale degree on the root,
+     * so every scale gets chords, not just the diatonic ones.
+     * The tables are rebuilt in set(), so the chord queries below are just lookups,
+     * and cost the same for triads and seventh chords.
+     *
+     * @param root is the scale degree of the chord root, 1..numDegrees()
+     * @param seventh is true for seventh chords, false for triads
+     */
+    PitchClassSet chordPitchClasses(int root, bool seventh) const {
+        assertRoot(root);
+        return chordPcs[seventh][root];
+    }
+
+    /**
+     * @return int 1, 3, 5 or 7 for the chord tones of this chord, 0 if not in chord.
+     */
+    int chordRole(int root, bool seventh, int pitchClass) const {
+        assertRoot(root);
+        assert(pitchClass >= 0 && pitchClass < 12);
+        return chordRoles[seventh][root][pitchClass];
+    }
+
+    /**
+     * @return int is a bit mask (1 << role) of the chord tones every voicing must contain.
+     * the fifth of a seventh chord may be left out.
+     */
+    int requiredChordRoles(int root, bool seventh) const {
+        assertRoot(root);
+        return requiredRoles[seventh][root];
+    }
+
+    /**
+     * @return the scale degree of the leading tone, or 0 if there isn't one.
+     * Always 7 in the diatonic modes, as in the traditional rules.
+     * Other scales only have one if their top degree is a half step below the tonic.
+     */
+    int leadingTone() const { return leadingToneDegree; }
+
+    /**
+     * @return the scale degree a perfect fifth above the tonic, or 0 if there isn't one.
+     * Always 5 in the diatonic modes.
+     */
+    int dominant() const { return dominantDegree; }
+
 private:
     ScalePtr scale;
+
+    void buildTables();
+    void assertRoot(int root) const {
+        assert(root > 0 && root <= degrees);
+    }
+
+    int degrees = 7;
+    int leadingToneDegree = 7;
+    int dominantDegree = 5;
+    int8_t degreeOfPitchClass[12] = {0};
+    PitchClassSet chordPcs[2][maxDegrees + 1];
+    int8_t chordRoles[2][maxDegrees + 1][12] = {{{0}}};
+    int requiredRoles[2][maxDegrees + 1] = {{0}};
 };
 
 using KeysigPtr = std::shared_ptr<Keysig>;
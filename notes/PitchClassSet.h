@@ -0,0 +1,51 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+
+/**
+ * A set of pitch classes, one bit per semitone. Bit 0 is C.
+ * Octave doesn't matter, so membership is a single AND.
+ */
+class PitchClassSet {
+public:
+    PitchClassSet() = default;
+    explicit PitchClassSet(uint16_t m) : mask(m) {
+        assert(m < (1 << 12));
+    }
+
+    /**
+     * @param pitch is any midi (or harmony note) pitch >= 0.
+     */
+    static int pitchClass(int pitch) {
+        assert(pitch >= 0);
+        return pitch % 12;
+    }
+
+    void add(int pc) {
+        assert(pc >= 0 && pc < 12);
+        mask |= (1 << pc);
+    }
+
+    bool contains(int pc) const {
+        assert(pc >= 0 && pc < 12);
+        return mask & (1 << pc);
+    }
+
+    int size() const {
+        int ret = 0;
+        for (unsigned m = mask; m; m &= (m - 1)) {
+            ++ret;
+        }
+        return ret;
+    }
+
+    bool empty() const { return mask == 0; }
+    uint16_t get() const { return mask; }
+
+    bool operator==(const PitchClassSet& other) const { return mask == other.mask; }
+    bool operator!=(const PitchClassSet& other) const { return mask != other.mask; }
+
+private:
+    uint16_t mask = 0;
+};
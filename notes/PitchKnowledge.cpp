@@ -33,6 +33,67 @@ std::string PitchKnowledge::nameOfAbs(int nPitch) {
     return s.str();
 }
 
+int PitchKnowledge::formatAbs(int nPitch, char* buffer) {
+    assert(nPitch >= 0);
+    const char* name = names[chromaticFromAbs(nPitch)];
+    int oct = octaveFromAbs(nPitch) - 3;
+
+    int length = 0;
+    while (*name) {
+        buffer[length++] = *name++;
+    }
+    if (oct < 0) {
+        buffer[length++] = '-';
+        oct = -oct;
+    }
+    assert(oct < 10);
+    buffer[length++] = char('0' + oct);
+    buffer[length] = 0;
+    assert(length <= maxNameLength);
+    return length;
+}
+
+int PitchKnowledge::parseAbs(const char* str, int& outPitch) {
+    // semitones above C for A..G
+    static const int letterOffsets[] = {9, 11, 0, 2, 4, 5, 7};
+
+    const char* p = str;
+    if (*p < 'A' || *p > 'G') {
+        return 0;
+    }
+    int pc = letterOffsets[*p - 'A'];
+    ++p;
+    if (*p == '#') {
+        ++pc;
+        ++p;
+    } else if (*p == 'b') {
+        --pc;
+        ++p;
+    }
+
+    bool negative = false;
+    if (*p == '-') {
+        negative = true;
+        ++p;
+    }
+    if (*p < '0' || *p > '9') {
+        return 0;
+    }
+    int oct = *p - '0';
+    ++p;
+    if (negative) {
+        oct = -oct;
+    }
+
+    // inverse of nameOfAbs
+    const int pitch = (oct + 2) * 12 + pc;
+    if (pitch < 0 || pitch > 127) {
+        return 0;
+    }
+    outPitch = pitch;
+    return int(p - str);
+}
+
 char const* const PitchKnowledge::names[] =
     {
         "X",  // no pitch zero in our world
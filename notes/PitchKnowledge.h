@@ -10,6 +10,25 @@ public:
 
     static std::string nameOfAbs(int nPitch);  // converts midi pitch to Name (a, b, c)
 
+    /**
+     * @brief same format as nameOfAbs, but no allocation.
+     * writes a terminating null.
+     *
+     * @param buffer must have room for maxNameLength + 1 chars
+     * @return int is the number of chars written, not counting the null
+     */
+    static int formatAbs(int nPitch, char* buffer);
+    static const int maxNameLength = 4;  // "C#-1"
+
+    /**
+     * @brief parses one pitch in nameOfAbs format (ex: "C#3") from the front of a string.
+     * Flats ("Db3") are accepted, too.
+     *
+     * @param outPitch gets the midi pitch
+     * @return int is the number of chars consumed, 0 if it isn't a pitch.
+     */
+    static int parseAbs(const char* str, int& outPitch);
+
 private:
     static char const* const names[13];
 };
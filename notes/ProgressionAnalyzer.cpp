@@ -9,17 +9,20 @@
 #include <sstream>
 
 #include "Chord4.h"
+#include "KeysigOld.h"
 #include "SqLog.h"
 
 static bool showAlways = false;
-void ProgressionAnalyzer::showAnalysis() {
+template <int NUM_VOICES>
+void ProgressionAnalyzerN<NUM_VOICES>::showAnalysis() {
     showAlways = true;
 }
 
 /* ProgressionAnalyzer::ProgressionAnalyzer(const Chord4 * const C1, const Chord4 * const C2)
     : First (C1), Next(C2)
  */
-ProgressionAnalyzer::ProgressionAnalyzer(const Chord4* C1, const Chord4* C2, bool fs)
+template <int NUM_VOICES>
+ProgressionAnalyzerN<NUM_VOICES>::ProgressionAnalyzerN(const Chord* C1, const Chord* C2, bool fs)
     : first(C1), next(C2), firstRoot(C1->fetchRoot()), nextRoot(C2->fetchRoot()), show(fs || showAlways) {
     figureMotion();  // init the motion guys
     notesInCommon = InCommon();
@@ -33,7 +36,8 @@ ProgressionAnalyzer::ProgressionAnalyzer(const Chord4* C1, const Chord4* C2, boo
 #endif
 }
 
-int ProgressionAnalyzer::getPenalty(const Options& options, int upperBound) const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::getPenalty(const Options& options, int upperBound) const {
 #if 0  // let's get rid of this fake rule
     if (!FakeRuleForDesc(options)) {
         return false;
@@ -69,7 +73,7 @@ int ProgressionAnalyzer::getPenalty(const Options& options, int upperBound) cons
         return totalPenalty;
     }
 
-    p = RuleForLeadingTone();
+    p = RuleForLeadingTone(options);
     totalPenalty += p;
     if (p && show) {
         str << "penalty: RuleForLeadingTone " << p << std::endl;
@@ -82,7 +86,7 @@ int ProgressionAnalyzer::getPenalty(const Options& options, int upperBound) cons
         return totalPenalty;
     }
 
-    p = RuleForPara();
+    p = RuleForPara(options);
     totalPenalty += p;
 
     if (p && show) {
@@ -182,8 +186,9 @@ int ProgressionAnalyzer::getPenalty(const Options& options, int upperBound) cons
     return totalPenalty;
 };
 
-int ProgressionAnalyzer::RuleForJumpSize() const {
-    for (int i = BASS; i <= SOP; i++) {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::RuleForJumpSize() const {
+    for (int i = BASS; i <= TOP_VOICE; i++) {
         int jump = first->fetchNotes()[i] - next->fetchNotes()[i];
         // This was 12 - I changed to 8. I think it was a typo.
         if (abs(jump) > 8) {
@@ -194,7 +199,8 @@ int ProgressionAnalyzer::RuleForJumpSize() const {
     return 0;
 }
 
-int ProgressionAnalyzer::RuleForInversions(const Options& options) const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::RuleForInversions(const Options& options) const {
     const auto style = options.style;
 
     if (style->getInversionPreference() == Style::InversionPreference::DONT_CARE) {
@@ -224,10 +230,11 @@ int ProgressionAnalyzer::RuleForInversions(const Options& options) const {
     return penalty;
 }
 
-int ProgressionAnalyzer::FakeRuleForDesc(const Options& options) const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::FakeRuleForDesc(const Options& options) const {
     if (!options.style->forceDescSop()) return true;                  // check if rule enabled
     assert(false);
-    bool ret = (next->fetchNotes()[SOP] < first->fetchNotes()[SOP]);  // For a test, lets make molody descend
+    bool ret = (next->fetchNotes()[TOP_VOICE] < first->fetchNotes()[TOP_VOICE]);  // For a test, lets make molody descend
     if (show && !ret) SQINFO("failed fake decrease melody");
     return ret ? 0 : AVG_PENALTY_PER_RULE;
 }
@@ -235,11 +242,12 @@ int ProgressionAnalyzer::FakeRuleForDesc(const Options& options) const {
 /* bool ProgressionAnalyzer::Rule4Same()
  * check if all 4 vx in same direction
  */
-int ProgressionAnalyzer::Rule4Same() const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::Rule4Same() const {
     DIREC di;
     int i;
 
-    for (i = 1, di = direction[0]; i <= SOP; i++) {
+    for (i = 1, di = direction[0]; i <= TOP_VOICE; i++) {
         if (direction[i] != di) return 0;  // if any direct dif, cool
                                            // is same ok?
     }
@@ -247,11 +255,12 @@ int ProgressionAnalyzer::Rule4Same() const {
     return AVG_PENALTY_PER_RULE;
 }
 
-int ProgressionAnalyzer::RuleForCross() const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::RuleForCross() const {
     int i, j;
 
-    for (i = BASS; i <= ALTO; i++) {
-        for (j = i + 1; j <= SOP; j++)  // for all voice pairs
+    for (i = BASS; i < TOP_VOICE; i++) {
+        for (j = i + 1; j <= TOP_VOICE; j++)  // for all voice pairs
         {
             if (direction[i] == direction[j])  // if similar motion
             {
@@ -280,13 +289,31 @@ int ProgressionAnalyzer::RuleForCross() const {
     return 0;
 }
 
-int ProgressionAnalyzer::RuleForPara() const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::intervalForPara(const Options& options, const Chord* chord, int lower, int upper) const {
+    if (options.keysig->numDegrees() == 7) {
+        return chord->fetchSRNNotes()[lower].interval(chord->fetchSRNNotes()[upper]);
+    }
+
+    // counting scale degrees only works in the diatonic scales, so go by semitones.
+    const int semitones = ((chord->fetchNotes()[upper] - chord->fetchNotes()[lower]) % 12 + 12) % 12;
+    switch (semitones) {
+        case 0:
+            return 1;
+        case 7:
+            return 5;
+    }
+    return 0;
+}
+
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::RuleForPara(const Options& options) const {
     int i, j;
 
     if (show) SQINFO("enter RuleForPara");
-    for (i = BASS; i <= ALTO; i++) {
-        for (j = i + 1; j <= SOP; j++) {
-            const int NextInterval = next->fetchSRNNotes()[i].interval(next->fetchSRNNotes()[j]);
+    for (i = BASS; i < TOP_VOICE; i++) {
+        for (j = i + 1; j <= TOP_VOICE; j++) {
+            const int NextInterval = intervalForPara(options, next, i, j);
             // figure the interval between these
 #if 0
         if (show) printf("in PAR, interval = %d, vx = %d to %d\n",
@@ -301,8 +328,7 @@ int ProgressionAnalyzer::RuleForPara() const {
 
                     if (show) SQINFO("next interval=%d between vx %d and %d", NextInterval, i, j);
                    
-                    const int FirstInterval =
-                        first->fetchSRNNotes()[i].interval(first->fetchSRNNotes()[j]);
+                    const int FirstInterval = intervalForPara(options, first, i, j);
                     if (FirstInterval == NextInterval)  // paralel 5 or 12
                     {
                         if (show) {
@@ -338,25 +364,31 @@ int ProgressionAnalyzer::RuleForPara() const {
     return 0;
 }
 
-int ProgressionAnalyzer::RuleForLeadingTone() const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::RuleForLeadingTone(const Options& options) const {
     int i, nPitch;
     bool fRet = true;
 
-    for (i = BASS; i <= SOP; i++) {
+    const KeysigOld& keysig = *options.keysig;
+    const int leadingTone = keysig.leadingTone();
+    if (!leadingTone) {
+        return 0;
+    }
+
+    for (i = BASS; i <= TOP_VOICE; i++) {
         nPitch = first->fetchSRNNotes()[i];                               // get the scale degree of this voice of chord
-        if (nPitch == 7) {                                                // if it is leading tone
+        if (nPitch == leadingTone) {                                      // if it is leading tone
             if (next->fetchNotes()[i] != (first->fetchNotes()[i] + 1)) {  // if it doesn't ascend to tonic
                 if (next->fetchNotes()[i] > first->fetchNotes()[i]) {     // and it is ascend..
                                                                           // over simplification: force all lead to asc to tonic or desc
                                                                           // in some cases must be stricter
                     fRet = false;
-                } else if (i == SOP) {     // if it is descending in soprano voice.
-                    if (firstRoot == 5) {  // and progression from V ...
-                        switch (nextRoot) {
-                            case 1:  // V-I must asc
-                            case 6:  // V-VI "  "
-                                fRet = false;
-                                break;
+                } else if (i == TOP_VOICE) {     // if it is descending in soprano voice.
+                    if (firstRoot == keysig.dominant()) {  // and progression from V ...
+                        if (nextRoot == 1) {                  // V-I must asc
+                            fRet = false;
+                        } else if (nextRoot == 6 && keysig.numDegrees() == 7) {  // V-VI "  "
+                            fRet = false;
                         }
                     }
                 }
@@ -367,7 +399,8 @@ int ProgressionAnalyzer::RuleForLeadingTone() const {
     return fRet ? 0 : AVG_PENALTY_PER_RULE;
 }
 
-int ProgressionAnalyzer::RuleForNoneInCommon(const Options& options) const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::RuleForNoneInCommon(const Options& options) const {
     DIREC di;
     int i;
 
@@ -380,9 +413,9 @@ int ProgressionAnalyzer::RuleForNoneInCommon(const Options& options) const {
     }
     // assert(notesInCommon == 0);
 
-    // No notes in common: upper 3 move opposite of bass
+    // No notes in common: upper voices move opposite of bass
 
-    for (di = direction[TENOR], i = ALTO; i <= SOP; i++) {
+    for (di = direction[TENOR], i = TENOR + 1; i <= TOP_VOICE; i++) {
         if (di != direction[i]) {
             if (show) SQINFO("violates notes in common rule 1a");
             return SLIGHTLY_HIGHER_PENALTY_PER_RULE;
@@ -394,7 +427,7 @@ int ProgressionAnalyzer::RuleForNoneInCommon(const Options& options) const {
     }
 
     // to nearest
-    for (i = BASS; i <= SOP; i++) {
+    for (i = BASS; i <= TOP_VOICE; i++) {
         if (!IsNearestNote(options, i)) {
             if (show) SQINFO("violates notes in common rule 1c");
             return AVG_PENALTY_PER_RULE;
@@ -404,14 +437,16 @@ int ProgressionAnalyzer::RuleForNoneInCommon(const Options& options) const {
     return 0;
 }
 
-int ProgressionAnalyzer::ruleForDoubling(const Options& options) const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::ruleForDoubling(const Options& options) const {
     assert(first->isAcceptableDoubling(options));
     assert(next->isAcceptableDoubling(options));
 
     return next->isCorrectDoubling(options) ? 0 : SLIGHTLY_LOWER_PENALTY_PER_RULE;
 }
 
-int ProgressionAnalyzer::ruleForSpreading(const Options& options) const {
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::ruleForSpreading(const Options& options) const {
     int ret = 0;
 
     if (options.style->pullTogether()) {
@@ -419,7 +454,7 @@ int ProgressionAnalyzer::ruleForSpreading(const Options& options) const {
         // const int distance = next->fetchNotes()[1] - next->fetchNotes()[0];
 
         // distance from bass to sop
-        const int distance = next->fetchNotes()[3] - next->fetchNotes()[0];
+        const int distance = next->fetchNotes()[TOP_VOICE] - next->fetchNotes()[BASS];
         if (distance > 12) {
             ret = PENALTY_FOR_FAR_APART;
         }
@@ -433,7 +468,8 @@ int ProgressionAnalyzer::ruleForSpreading(const Options& options) const {
 
 /* bool ProgressionAnalyzer::IsNearestNote(int nVoice)
  */
-bool ProgressionAnalyzer::IsNearestNote(const Options& options, int nVoice) const {
+template <int NUM_VOICES>
+bool ProgressionAnalyzerN<NUM_VOICES>::IsNearestNote(const Options& options, int nVoice) const {
     bool done;
     HarmonyNote ntFirst(options);
     HarmonyNote ntNext(options);
@@ -462,8 +498,9 @@ bool ProgressionAnalyzer::IsNearestNote(const Options& options, int nVoice) cons
 
 /* void ProgressionAnalyzer::FigureMotion()
  */
-void ProgressionAnalyzer::figureMotion() {
-    for (int i = BASS; i <= SOP; i++)  // for each voice
+template <int NUM_VOICES>
+void ProgressionAnalyzerN<NUM_VOICES>::figureMotion() {
+    for (int i = BASS; i <= TOP_VOICE; i++)  // for each voice
     {
         magMotion[i] = next->fetchNotes()[i] -
                        first->fetchNotes()[i];  // figure how much it changed
@@ -482,14 +519,15 @@ void ProgressionAnalyzer::figureMotion() {
  * find how many voices are in common (by degree, not abs pitch)
  */
 
-int ProgressionAnalyzer::InCommon() const {
-    bool test[10];  // 8 degrees + 0 + 1 spare
+template <int NUM_VOICES>
+int ProgressionAnalyzerN<NUM_VOICES>::InCommon() const {
+    bool test[13];  // 12 degrees (chromatic) + 0
     int matches;
     int i, nPitch;
 
     memset(test, 0, sizeof(test));  // clear our test hit array
 
-    for (i = 0; i < CHORD_SIZE; i++) {
+    for (i = 0; i < NUM_VOICES; i++) {
         //    nPitch = First.FetchNotes()[i];	// get the pitch of this chord member
         nPitch = first->fetchSRNNotes()[i];  // get the scale degree of this chord member
         test[nPitch] = true;                 // mark that we are here
@@ -497,9 +535,14 @@ int ProgressionAnalyzer::InCommon() const {
 
     // We have now marked all the pitches in our chord
 
-    for (i = matches = 0; i < CHORD_SIZE; i++) {
+    for (i = matches = 0; i < NUM_VOICES; i++) {
         nPitch = next->fetchSRNNotes()[i];
         if (test[nPitch]) matches++;
     }
     return matches;
 }
+
+template class ProgressionAnalyzerN<3>;
+template class ProgressionAnalyzerN<4>;
+template class ProgressionAnalyzerN<5>;
+template class ProgressionAnalyzerN<6>;
@@ -1,7 +1,8 @@
 
 #pragma once
 
-class Chord4;
+template <int NUM_VOICES>
+class ChordN;
 class Options;
 
 enum DIREC {
@@ -10,9 +11,15 @@ enum DIREC {
     DIR_DOWN
 };
 
-class ProgressionAnalyzer {
+/**
+ * Analyzes the motion from one chord to the next.
+ * Templated on voice count to match ChordN.
+ */
+template <int NUM_VOICES>
+class ProgressionAnalyzerN {
 public:
-    ProgressionAnalyzer(const Chord4* C1, const Chord4* C2, bool fShow);
+    using Chord = ChordN<NUM_VOICES>;
+    ProgressionAnalyzerN(const Chord* C1, const Chord* C2, bool fShow);
     // bool isLegal(const Options&) const;
 
     static const int PENALTY_FOR_REPEATED_CHORDS = {50};
@@ -30,13 +37,15 @@ public:
     static void showAnalysis();
 
 private:
-    const Chord4* const first;
-    const Chord4* const next;
+    static const int TOP_VOICE = NUM_VOICES - 1;  // the soprano
+
+    const Chord* const first;
+    const Chord* const next;
     const int firstRoot;
     const int nextRoot;
 
-    int magMotion[4];    // derived motion for each voice (magnitude)
-    DIREC direction[4];  // "    "
+    int magMotion[NUM_VOICES];    // derived motion for each voice (magnitude)
+    DIREC direction[NUM_VOICES];  // "    "
     int notesInCommon;
     const bool show;  // for debugging
 
@@ -49,12 +58,17 @@ private:
     int RuleForNoneInCommon(const Options&) const;
     int ruleForDoubling(const Options& options) const;
     int ruleForSpreading(const Options& options) const;
-    int RuleForLeadingTone() const;
-    int RuleForPara() const;
+    int RuleForLeadingTone(const Options& options) const;
+    int RuleForPara(const Options& options) const;
     int RuleForCross() const;                                   // vx in similar motion shouldn't cross
     int RuleForInversions(const Options& options) const;  // rule for two consec chords in first inversion
     int RuleForJumpSize() const;
     int FakeRuleForDesc(const Options& options) const;  // force descending melody for torture test!
 
     bool IsNearestNote(const Options&, int Vx) const;  // True if the voice went to the nearest available slot
+
+    // 5 for a fifth, 1 for a unison or octave, between two voices of a chord. Other intervals are something else.
+    int intervalForPara(const Options& options, const Chord* chord, int lower, int upper) const;
 };
+
+using ProgressionAnalyzer = ProgressionAnalyzerN<4>;
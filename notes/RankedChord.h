@@ -62,6 +62,8 @@ public:
     ~RankedChord();
     bool makeNext();              // advance to next worst chord
     void reset();                 // set us back to the first chord in rank
+    void setRank(int rank);
+    int getRoot() const { return root; }
   //  const Chord4& fetch() const;  // get the current chord
     const Chord4* fetch2() const;
     void print() const;           // print the current chord
@@ -90,6 +92,11 @@ inline void RankedChord::reset() {
     curRank = 0;
 }
 
+inline void RankedChord::setRank(int rank) {
+    assert(rank >= 0 && rank < chords.size(root));
+    curRank = rank;
+}
+
 inline bool RankedChord::makeNext() {
     bool ret;
 
@@ -14,10 +14,11 @@ public:
 
 private:
     int pitch=0;      // valid values are 1..12
-                    // I think they are 1..8!
+                    // 1..7 for the diatonic scales, up to 12 for chromatic
     friend Keysig;  // so he can call set on us
 };
 
+// Counts scale degrees, so only makes sense in the diatonic (7 degree) scales.
 inline int ScaleRelativeNote::interval(const ScaleRelativeNote& Higher) const {
     int ret;
     ret = Higher + 1 - pitch;
@@ -30,6 +31,6 @@ inline void ScaleRelativeNote::set(int nPitch) {
 }
 
 inline bool ScaleRelativeNote::isValid() const {
-    return (pitch >= 1) && (pitch <= 7);
+    return (pitch >= 1) && (pitch <= 12);
 }
 
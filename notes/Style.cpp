@@ -3,6 +3,8 @@
 
 #include "Style.h"
 
+#include <assert.h>
+
 bool Style::allowVoiceCrossing() {
     return false;
 }
@@ -31,6 +33,27 @@ bool Style::getNoNotesInCommon() const {
     return enableNoNotesInCommonRule;
 }
 
+void Style::setSeventhChords(bool b) {
+    seventhChords = b;
+}
+
+void Style::setVoiceLeading(VoiceLeading v) {
+    voiceLeading = v;
+}
+
+int Style::motionPenalty() const {
+    switch (voiceLeading) {
+        case VoiceLeading::RULES_ONLY:
+            return 0;
+        case VoiceLeading::WEIGHTED:
+            return 10;  // ten semitones of motion is as bad as breaking a rule
+        case VoiceLeading::SMOOTHEST:
+            return 10000;  // more than all the rules put together
+    }
+    assert(false);
+    return 0;
+}
+
 int Style::minSop() const {
     if (specialTestMode) {
         return dx + 60;
@@ -76,6 +99,31 @@ int Style::maxBass() const {
     return 60;
 }
 
+// interpolate between the four SATB values.
+static int voiceRange(const int* satb, int voice, int numVoices) {
+    assert(numVoices > 1);
+    assert(voice >= 0 && voice < numVoices);
+    const int numerator = voice * 3;
+    const int denominator = numVoices - 1;
+    const int lower = numerator / denominator;
+    const int remainder = numerator % denominator;
+    if (remainder == 0) {
+        return satb[lower];
+    }
+    const int span = satb[lower + 1] - satb[lower];
+    return satb[lower] + (span * remainder + denominator / 2) / denominator;
+}
+
+int Style::minPitch(int voice, int numVoices) const {
+    const int satb[] = {minBass(), minTenor(), minAlto(), minSop()};
+    return voiceRange(satb, voice, numVoices);
+}
+
+int Style::maxPitch(int voice, int numVoices) const {
+    const int satb[] = {maxBass(), maxTenor(), maxAlto(), maxSop()};
+    return voiceRange(satb, voice, numVoices);
+}
+
 #if 0
 void Style::print() {
     CString Str;
@@ -17,6 +17,7 @@ public:
     int maxUnison();            // may number of unisons allowed in a chord
     bool allow2ndInversion();
     bool allow1stInversion();
+    bool allow3rdInversion();   // only seventh chords have one
 
     bool requireStdDoubling();  // chords required to double root, etc???
                                 // I think this means double root always!!
@@ -32,6 +33,16 @@ public:
     int minBass() const;
     int maxBass() const;
 
+    /**
+     * @brief pitch range for one voice when writing in other than four parts.
+     * For four voices these are exactly the SATB ranges above; for other
+     * voice counts the ranges are interpolated between them.
+     *
+     * @param voice is 0 for the bass, numVoices - 1 for the soprano
+     */
+    int minPitch(int voice, int numVoices) const;
+    int maxPitch(int voice, int numVoices) const;
+
     /** new: setters *****************/
 
     enum class InversionPreference {
@@ -57,6 +68,23 @@ public:
     void setNoNotesInCommon(bool);
     bool getNoNotesInCommon() const;
 
+    // true for seventh chords, false for triads
+    void setSeventhChords(bool);
+    bool getSeventhChords() const { return seventhChords; }
+
+    enum class VoiceLeading {
+        RULES_ONLY,  // first chord with the lowest rule penalty
+        WEIGHTED,    // rule penalty plus a penalty for each semitone the voices move
+        SMOOTHEST    // least voice motion, rules only break ties
+    };
+    void setVoiceLeading(VoiceLeading);
+    VoiceLeading getVoiceLeading() const { return voiceLeading; }
+
+    /**
+     * @return penalty per semitone of total voice motion, 0 for RULES_ONLY.
+     */
+    int motionPenalty() const;
+
     bool pullTogether() const { return rangesPreference == Ranges::ENCOURAGE_CENTER; }
 
     void setSpecialTestMode(int amt) {
@@ -69,6 +97,8 @@ private:
     InversionPreference inversionPreference = InversionPreference::DISCOURAGE_CONSECUTIVE;
     Ranges rangesPreference = Ranges::NORMAL_RANGE;
     bool enableNoNotesInCommonRule = true;
+    bool seventhChords = false;
+    VoiceLeading voiceLeading = VoiceLeading::RULES_ONLY;
 
     bool isNarrowRange() const { 
         return (rangesPreference == Ranges::NARROW_RANGE) || specialTestMode;
@@ -121,6 +151,10 @@ inline bool Style::allow1stInversion() {
     return true;
 }
 
+inline bool Style::allow3rdInversion() {
+    return true;
+}
+
 inline int Style::maxUnison() {
     return 0;  // bgf 1/4/93
 }
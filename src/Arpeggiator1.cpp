@@ -20,6 +20,20 @@ public:
         comp->process(args);
     }
 
+    json_t* dataToJson() override {
+        json_t* root = json_object();
+        json_object_set_new(root, "pattern", json_string(comp->getPattern().c_str()));
+        return root;
+    }
+
+    void dataFromJson(json_t* root) override {
+        json_t* pattern = json_object_get(root, "pattern");
+        if (json_is_string(pattern)) {
+            std::string error;
+            comp->setPattern(json_string_value(pattern), error);
+        }
+    }
+
 private:
     void addParams();
 };
@@ -30,9 +44,12 @@ inline void Arpeggiator1Module::addParams() {
     this->configParam(Comp::LENGTH_PARAM, 0, 12, 0, "Note Buffer Length");
     this->configParam(Comp::BEATS_PARAM, 0, 12, 0, "Number of Beats");
     this->configParam(Comp::SCHEMA_PARAM, 0, 10, 0, "Schema");
-    this->configParam(Comp::POLY_PARAM, 0, 1, 0, "Poly");
+    this->configParam(Comp::POLY_PARAM, 0, 16, 0, "Input channels per arpeggiator");
     this->configParam(Comp::RESET_MODE_PARAM, 0, 1, 1, "Reset Mode");
-    this->configParam(Comp::GATE_DELAY_PARAM, 0, 1, 1, "Gate Delay");
+    this->configSwitch(Comp::GATE_DELAY_PARAM, 0, 2, 1, "Gate Delay", {"off", "5 samples", "adaptive"});
+    this->configParam(Comp::CAPTURE_PARAM, 0, 20, 0, "Chord capture window", " ms");
+    this->configParam(Comp::SEED_PARAM, 0, 7, 0, "Shuffle seed");
+    this->configSwitch(Comp::NO_REPEAT_PARAM, 0, 1, 0, "Shuffle no repeat", {"off", "on"});
 
     this->configSwitch(Comp::HOLD_PARAM, 0, 1, 0, "Hold", {"off", "on"});
 
@@ -92,6 +109,36 @@ struct RoundSmallBlackSnapKnob : RoundSmallBlackKnob {
     }
 };
 
+/**
+ * Type a pattern in the context menu, enter to use it.
+ */
+struct PatternField : ui::TextField {
+    Arpeggiator1Module* module;
+    MenuLabel* errorLabel;
+    PatternField(Arpeggiator1Module* m, MenuLabel* label) : module(m), errorLabel(label) {
+        box.size.x = 180;
+        placeholder = "1 3 2 4 +oct 1";
+        text = module->comp->getPattern();
+        selectAll();
+    }
+
+    void onSelectKey(const SelectKeyEvent& e) override {
+        if (e.action == GLFW_PRESS && (e.key == GLFW_KEY_ENTER || e.key == GLFW_KEY_KP_ENTER)) {
+            std::string error;
+            if (module->comp->setPattern(text, error)) {
+                ui::MenuOverlay* overlay = getAncestorOfType<ui::MenuOverlay>();
+                overlay->requestDelete();
+            } else {
+                errorLabel->text = error;
+            }
+            e.consume(this);
+        }
+        if (!e.getTarget()) {
+            TextField::onSelectKey(e);
+        }
+    }
+};
+
 struct Arpeggiator1Widget : ModuleWidget {
     Arpeggiator1Widget(Arpeggiator1Module* module) {
         setModule(module);
@@ -213,9 +260,31 @@ struct Arpeggiator1Widget : ModuleWidget {
         item->text = "Reset Mode II";
         theMenu->addChild(item);
 
-        item = new SqMenuItem_BooleanParam2(module, Comp::GATE_DELAY_PARAM);
-        item->text = "Gate Delay";
-        theMenu->addChild(item);
+        theMenu->addChild(new MenuLabel());
+        SqMenuItem_ParamValue::addGroup(theMenu, module, "Gate Delay", Comp::GATE_DELAY_PARAM, {0, 1, 2}, {"Off", "5 samples", "Adaptive"});
+
+        theMenu->addChild(new MenuLabel());
+        SqMenuItem_ParamValue::addGroup(theMenu, module, "Polyphonic", Comp::POLY_PARAM, {0, 1, 2, 3, 4}, {"Off", "1 channel per arp", "2 channels per arp", "3 channels per arp", "4 channels per arp"});
+
+        theMenu->addChild(new MenuLabel());
+        SqMenuItem_ParamValue::addGroup(theMenu, module, "Chord capture window", Comp::CAPTURE_PARAM, {0, 1, 2, 5, 10}, {"Off", "1 ms", "2 ms", "5 ms", "10 ms"});
+
+        theMenu->addChild(new MenuLabel());
+        SqMenuItem_ParamValue::addGroup(theMenu, module, "Shuffle seed", Comp::SEED_PARAM, {0, 1, 2, 3, 4, 5, 6, 7}, {"0", "1", "2", "3", "4", "5", "6", "7"});
+        SqMenuItem_BooleanParam2* noRepeatItem = new SqMenuItem_BooleanParam2(module, Comp::NO_REPEAT_PARAM);
+        noRepeatItem->text = "Shuffle: no repeat between cycles";
+        theMenu->addChild(noRepeatItem);
+
+        Arpeggiator1Module* arpModule = getModule<Arpeggiator1Module>();
+        if (arpModule) {
+            theMenu->addChild(new MenuLabel());
+            MenuLabel* label = new MenuLabel();
+            label->text = "Pattern (empty to use the mode)";
+            theMenu->addChild(label);
+            MenuLabel* errorLabel = new MenuLabel();
+            theMenu->addChild(new PatternField(arpModule, errorLabel));
+            theMenu->addChild(errorLabel);
+        }
     }
 };
 
@@ -31,6 +31,7 @@ struct Harmony1Widget : ModuleWidget {
         addLabel(Vec(28, 5), "Harmony");
 
         addInputL(Vec(vlx, 280), Comp::CV_INPUT, "Root");
+        addInputL(Vec(vlx + 2 * vdelta, 280), Comp::CHORD_INPUT, "Chord");
         addScore(module);
 
         addKeysig();
@@ -86,8 +87,8 @@ struct Harmony1Widget : ModuleWidget {
             Vec(57, yMode),
             module,
             Comp::MODE_PARAM);
-        p->setShortLabels(Scale::getShortScaleLabels(true));
-        p->setLabels(Scale::getScaleLabels(true));
+        p->setShortLabels(Scale::getShortScaleLabels(false));
+        p->setLabels(Scale::getScaleLabels(false));
 
         p->box.size.x = 70;  // width
         p->box.size.y = 22;
@@ -102,6 +103,26 @@ struct Harmony1Widget : ModuleWidget {
         SqMenuItem_BooleanParam2* item = new SqMenuItem_BooleanParam2(module, Comp::SCORE_COLOR_PARAM);
         item->text = "Black notes on white paper";
         theMenu->addChild(item);
+
+        item = new SqMenuItem_BooleanParam2(module, Comp::SEVENTH_CHORDS_PARAM);
+        item->text = "Seventh chords";
+        theMenu->addChild(item);
+
+        item = new SqMenuItem_BooleanParam2(module, Comp::INPUT_MODE_PARAM);
+        item->text = "Input is soprano melody";
+        theMenu->addChild(item);
+
+        item = new SqMenuItem_BooleanParam2(module, Comp::PIVOT_PARAM);
+        item->text = "Pivot chord on key change";
+        theMenu->addChild(item);
+
+        // for knobs and slewed CV: don't harmonize every degree the input passes through
+        theMenu->addChild(new MenuLabel());
+        SqMenuItem_ParamValue::addGroup(theMenu, module, "Input settle time", Comp::SETTLE_TIME_PARAM, {0, 5, 20, 50}, {"Off", "5 ms", "20 ms", "50 ms"});
+        SqMenuItem_ParamValue::addGroup(theMenu, module, "Input hysteresis", Comp::HYSTERESIS_PARAM, {0, .25f, .5f}, {"Off", "1/4 semitone", "1/2 semitone"});
+
+        theMenu->addChild(new MenuLabel());
+        SqMenuItem_ParamValue::addGroup(theMenu, module, "Voice leading", Comp::VOICE_LEADING_PARAM, {0, 1, 2}, {"Rules only", "Rules and smooth", "Smoothest"});
     }
 
     void step() override {
@@ -165,6 +186,12 @@ void Harmony1Widget::addScore(Harmony1Module* module) {
 
     vu->box.pos = Vec(7, 26),
     addChild(vu);
+
+    // The chords go on top, so a new chord doesn't redraw the staves.
+    // Each slot moves to wherever its chord is shown.
+    for (int slot = 0; slot < Score::numSlots; ++slot) {
+        addChild(new ScoreColumnParent(_score, new ScoreColumn(_score, slot), vu->box.pos));
+    }
 }
 
 Model* modelHarmony1 = createModel<Harmony1Module, Harmony1Widget>("sqh-harmony1");
\ No newline at end of file
@@ -18,7 +18,7 @@ public:
         this->configParam(Comp::SCORE_GLOW_PARAM, 0, 1, 0, "Score Glow");
         this->configParam(Comp::SCHEMA_PARAM, 0, 1, 0, "hidden schema");
         this->configParam(Comp::KEY_PARAM, 0, 11, 0, "Key Root");
-        this->configParam(Comp::MODE_PARAM, 0, 6, 0, "Diatonic Mode");
+        this->configParam(Comp::MODE_PARAM, 0, int(Scale::Scales::WholeStep), 0, "Scale");
 /*
        DONT_CARE,
         DISCOURAGE_CONSECUTIVE,
@@ -35,6 +35,12 @@ public:
     */
         this->configSwitch(Comp::CENTER_PREFERENCE_PARAM, 0, 2, 0, "Centered preference", {"None", "ENCOURAGE_CENTER", "NARROW_RANGE"});
         this->configSwitch(Comp::NNIC_PREFERENCE_PARAM, 0, 1, 1, "No Notes in Common rule", {"Disable", "enabled"});
+        this->configSwitch(Comp::SEVENTH_CHORDS_PARAM, 0, 1, 0, "Chord type", {"Triads", "Seventh chords"});
+        this->configParam(Comp::SETTLE_TIME_PARAM, 0, 100, 0, "Input settle time", " ms");
+        this->configParam(Comp::HYSTERESIS_PARAM, 0, 1, 0, "Input hysteresis", " semitones");
+        this->configSwitch(Comp::INPUT_MODE_PARAM, 0, 1, 0, "Input mode", {"Chord root", "Soprano melody"});
+        this->configSwitch(Comp::PIVOT_PARAM, 0, 1, 0, "Pivot chord on key change", {"Off", "On"});
+        this->configSwitch(Comp::VOICE_LEADING_PARAM, 0, 2, 0, "Voice leading", {"Rules only", "Rules and smooth", "Smoothest"});
 
 
         this->configOutput(Comp::BASS_OUTPUT, "Bass voice pitch");
@@ -42,7 +48,8 @@ public:
         this->configOutput(Comp::ALTO_OUTPUT, "Alto voice pitch");
         this->configOutput(Comp::SOPRANO_OUTPUT, "Soprano voice pitch");
 
-        this->configInput(Comp::CV_INPUT, "Chord root scale degree");
+        this->configInput(Comp::CV_INPUT, "Chord root scale degree (poly: one harmonizer per channel)");
+        this->configInput(Comp::CHORD_INPUT, "Chord to continue from (four poly pitches)");
     }
 
     using Chord = Comp::Chord;
@@ -46,6 +46,13 @@ public:
         }
     }
 
+    /**
+     * With this off, moving us by part of a pixel won't redraw the framebuffer.
+     */
+    void setDirtyOnSubpixelChange(bool b) {
+        fw->dirtyOnSubpixelChange = b;
+    }
+
 private:
     Widget *dbg = nullptr;
     FramebufferWidget *fw = nullptr;
@@ -53,8 +60,16 @@ private:
 };
 //     return APP->engine->getParamValue(module, paramId) > .5;
 
+/**
+ * Score draws the staves, clefs and key signature. The chords are drawn
+ * by ScoreColumn widgets, one per slot of the chord ring, each in its own
+ * small framebuffer. Chords are shown oldest to newest, so when the ring is
+ * full every chord moves left one column, but only the new chord is redrawn.
+ */
 class Score : public app::LightWidget, public Dirty {
 public:
+    static const int numSlots = 8;
+
     Score(Harmony1Module *);
     void step() override;
     void draw(const DrawArgs &args) override;
@@ -64,13 +79,40 @@ public:
     }
 
     void setWhiteOnBlack(bool b) {
+        if (b == whiteOnBlack) {
+            return;
+        }
         whiteOnBlack = b;
         // INFO("set white on block %d", whiteOnBlack );
-        scoreIsDirty = true;
+        markAllDirty();
+    }
+
+    /**
+     * @param slot is the place in the chord ring.
+     */
+    bool isSlotDirty(int slot) const {
+        return slotIsDirty[slot];
+    }
+    void drawSlot(const DrawArgs &args, int slot);
+
+    /**
+     * Where the chord in slot is shown, relative to the Score. Moves when the key
+     * signature changes, and when the chords scroll.
+     */
+    Vec slotPos(int slot) const {
+        return Vec(noteXPos(columnForSlot(slot), currentKeysigWidth) - columnInset, 0);
+    }
+
+    /**
+     * Just wide enough for the notes, ledger lines and chord number.
+     */
+    Vec columnSize() const {
+        return Vec(columnWidth, box.size.y);
     }
 
 private:
-    bool scoreIsDirty = false;
+    bool scoreIsDirty = true;
+    void markAllDirty();
     void filledRect(NVGcontext *vg, NVGcolor color, float x, float y, float w, float h, float rounding) const;
     void drawHLine(NVGcontext *vg, NVGcolor color, float x, float y, float length, float width) const;
     void drawVLine(NVGcontext *vg, NVGcolor color, float x, float y, float length, float width) const;
@@ -101,11 +143,36 @@ private:
      * @return std::pair<float, bool> first is the y position, second it flag if need ledger line
      */
     YInfo noteYInfo(const MidiNote &note, bool bassStaff) const;
+    YInfo computeNoteYInfo(const MidiNote &note, bool bassStaff) const;
     float noteY(const MidiNote &note, bool bassStaff) const;
 
+    // noteYInfo for every midi pitch, [0] for treble staff, [1] for bass.
+    YInfo yInfoTable[2][128];
+
     Harmony1Module *const module;
-    std::list<Comp::Chord> chords;
+
+    // ring of chord slots. nextSlot is the one the next chord will go in.
+    Comp::Chord chords[numSlots];
+    int numChords = 0;
+    bool slotIsDirty[numSlots] = {false};
+    int nextSlot = 0;
+
+    // the place on the staff where the chord in slot is shown, 0 is the leftmost
+    int columnForSlot(int slot) const {
+        return (numChords < numSlots) ? slot : (slot - nextSlot + numSlots) % numSlots;
+    }
+
+    static constexpr float columnInset = 3;  // ledger lines and down stems go left of x
+    static constexpr float columnWidth = 12;
+
     bool whiteOnBlack = true;
+    int lastKeysig = -1;
+    float currentKeysigWidth = 0;
+
+    /**
+     * @return the width of the key signature drawing, without drawing it.
+     */
+    float computeKeysigWidth(const Scale::ScoreInfo &) const;
 
     const std::string noteQuarterUp = u8"\ue1d5";
     const std::string noteQuarterDown = u8"\ue1d6";
@@ -123,8 +190,8 @@ private:
      * @return float width of key signature
      */
     float drawMusicNonNotes(const DrawArgs &args) const;
-    void drawChordNumbers(const DrawArgs &args, float widthOfKeysig) const;
-    void drawNotes(const DrawArgs &args, float widthOfKsig) const;
+    void drawChordNumber(const DrawArgs &args, float x, int slot) const;
+    void drawNotes(const DrawArgs &args, float x, int slot) const;
 
     /**
      * @return float width of key signature
@@ -164,6 +231,54 @@ private:
     // const float barlineX2 = barlineX1 + 43;     // 40 too small 46 too big
 };
 
+/**
+ * Draws the chord in one slot of the Score's chord ring.
+ */
+class ScoreColumn : public app::LightWidget, public Dirty {
+public:
+    ScoreColumn(Score *s, int sl) : score(s), slot(sl) {}
+    bool isDirty() const override {
+        return score->isSlotDirty(slot);
+    }
+    void draw(const DrawArgs &args) override {
+        score->drawSlot(args, slot);
+        Widget::draw(args);
+    }
+    int getSlot() const {
+        return slot;
+    }
+
+private:
+    Score *const score;
+    const int slot;
+};
+
+/**
+ * Holds a ScoreColumn in its own column sized framebuffer, over the top of the Score,
+ * and keeps it where its chord is shown. Moving doesn't redraw the framebuffer.
+ */
+class ScoreColumnParent : public BufferingParent {
+public:
+    /**
+     * @param scorePos is where the Score is, in our parent.
+     */
+    ScoreColumnParent(Score *s, ScoreColumn *column, Vec scorePos) : BufferingParent(column, s->columnSize(), column),
+                                                                     score(s),
+                                                                     slot(column->getSlot()),
+                                                                     origin(scorePos) {
+        setDirtyOnSubpixelChange(false);
+    }
+    void step() override {
+        box.pos = origin.plus(score->slotPos(slot));
+        BufferingParent::step();
+    }
+
+private:
+    Score *const score;
+    const int slot;
+    const Vec origin;
+};
+
 NVGcolor Score::getForegroundColor() const {
     return whiteOnBlack ? nvgRGB(0xff, 0xff, 0xff) : nvgRGB(0, 0, 0);
 }
@@ -186,20 +301,44 @@ inline Score::Score(Harmony1Module *m) : module(m) {
     ch.pitch[1] = MidiNote::MiddleC;
     ch.pitch[2] = MidiNote::MiddleC + 4;
     ch.pitch[3] = MidiNote::MiddleC + 8;
-    chords.push_back(ch);
+    chords[0] = ch;
+    numChords = 1;
+    nextSlot = 1;
 
 #endif
+    for (int pitch = 0; pitch < 128; ++pitch) {
+        yInfoTable[0][pitch] = computeNoteYInfo(MidiNote(pitch), false);
+        yInfoTable[1][pitch] = computeNoteYInfo(MidiNote(pitch), true);
+    }
+    markAllDirty();
+}
+
+inline void Score::markAllDirty() {
+    scoreIsDirty = true;
+    for (int i = 0; i < numSlots; ++i) {
+        slotIsDirty[i] = true;
+    }
 }
 
 inline void Score::step() {
 #ifndef _TESTCHORD
     if (module) {
-        if (module->isChordAvailable()) {
-            scoreIsDirty = true;
-            auto ch = module->getChord();
-            chords.push_back(ch);
-            if (chords.size() > 8) {
-                chords.pop_front();
+        // a new key signature moves everything over
+        const auto info = module->getScale()->getScoreInfo();
+        const int keysig = info.numSharps * 16 + info.numFlats;
+        if (keysig != lastKeysig) {
+            lastKeysig = keysig;
+            currentKeysigWidth = computeKeysigWidth(info);
+            markAllDirty();
+        }
+
+        // once the ring is full the others scroll left one, but that only moves them.
+        while (module->isChordAvailable()) {
+            chords[nextSlot] = module->getChord();
+            slotIsDirty[nextSlot] = true;
+            nextSlot = (nextSlot + 1) % numSlots;
+            if (numChords < numSlots) {
+                ++numChords;
             }
         }
     }
@@ -243,6 +382,14 @@ float Score::noteY(const MidiNote &note, bool bassStaff) const {
 }
 
 inline Score::YInfo Score::noteYInfo(const MidiNote &note, bool bassStaff) const {
+    const int pitch = note.get();
+    if (pitch < 0 || pitch > 127) {
+        return computeNoteYInfo(note, bassStaff);
+    }
+    return yInfoTable[bassStaff][pitch];
+}
+
+inline Score::YInfo Score::computeNoteYInfo(const MidiNote &note, bool bassStaff) const {
     YInfo ret;
     if (note.get() < 10) {
         return ret;
@@ -305,57 +452,62 @@ inline void Score::drawLayer(const DrawArgs &args, int layer) {
 inline void Score::draw(const DrawArgs &args) {
     //  INFO("Score::draw");
     nvgScissor(args.vg, RECT_ARGS(args.clipBox));
-    const float width = drawMusicNonNotes(args);
-    drawNotes(args, width);
-    drawChordNumbers(args, width);
+    drawMusicNonNotes(args);
     scoreIsDirty = false;
     Widget::draw(args);
 }
 
-inline void Score::drawChordNumbers(const DrawArgs &args, float widthOfKeysig) const {
-    if (chords.empty()) {
-        return;
-    }
-    prepareFontText(args);
-    int i = 0;
-    for (auto chord : chords) {
-        const float x = noteXPos(i, widthOfKeysig) + 1.5;
-        drawChordInfo(args, x, chord);
-        ++i;
+// Called by the ScoreColumn for slot, which is drawing at its own position.
+// The background is already drawn underneath.
+inline void Score::drawSlot(const DrawArgs &args, int slot) {
+    slotIsDirty[slot] = false;
+    if (slot >= numChords) {
+        return;  // the ring fills in order
     }
+    nvgScissor(args.vg, RECT_ARGS(args.clipBox));
+    prepareFontMusic(args);
+    nvgFillColor(args.vg, getForegroundColor());
+    drawNotes(args, columnInset, slot);
+    drawChordNumber(args, columnInset, slot);
 }
 
+inline void Score::drawChordNumber(const DrawArgs &args, float x, int slot) const {
+    prepareFontText(args);
+    drawChordInfo(args, x + 1.5, chords[slot]);
+}
 
+inline void Score::drawNotes(const DrawArgs &args, float x, int slot) const {
+    const Comp::Chord &chord = chords[slot];
 
-inline void Score::drawNotes(const DrawArgs &args, float keysigWidth) const {
-    if (!chords.empty()) {
-        // INFO("chords to score %d", int(chords.size()));
-        int i = 0;
-        for (auto chord : chords) {
-            // SQINFO("x = %f w=%f", noteXPos(i), keysigWidth);
-
-            // note - we could add inset ourself in noteXPos.
-            const float x = noteXPos(i, keysigWidth);
-
-            for (int i = 0; i < 4; ++i) {
-                const bool stemUp = i % 2;
-                auto yInfo = noteYInfo(chord.pitch[i], i < 2);
+    for (int i = 0; i < 4; ++i) {
+        const bool stemUp = i % 2;
+        const YInfo &yInfo = noteYInfo(chord.pitch[i], i < 2);
 
-                for (int i = 0; i < 3; ++i) {
-                    if (yInfo.ledgerPos[i] != 0) {
-                        // printf("drawing ledger at %f\n", yInfo.ledgerPos[i]);
-                        nvgText(args.vg, x, yInfo.ledgerPos[i], ledgerLine.c_str(), NULL);
-                    }
-                }
-                const char *note = stemUp ? noteQuarterUp.c_str() : noteQuarterDown.c_str();
-                // printf("drawing note at %f\n", yInfo.position);
-                nvgText(args.vg, x, yInfo.position, note, NULL);
+        for (int j = 0; j < 3; ++j) {
+            if (yInfo.ledgerPos[j] != 0) {
+                // printf("drawing ledger at %f\n", yInfo.ledgerPos[j]);
+                nvgText(args.vg, x, yInfo.ledgerPos[j], ledgerLine.c_str(), NULL);
             }
-            ++i;
         }
+        const char *note = stemUp ? noteQuarterUp.c_str() : noteQuarterDown.c_str();
+        // printf("drawing note at %f\n", yInfo.position);
+        nvgText(args.vg, x, yInfo.position, note, NULL);
     }
 }
 
+inline float Score::computeKeysigWidth(const Scale::ScoreInfo &info) const {
+    // same choice of flats or sharps as drawKeysig, which uses 4 per accidental
+    int num = 0;
+    if (info.numFlats == 0) {
+        num = info.numSharps;
+    } else if (info.numSharps == 0) {
+        num = info.numFlats;
+    } else {
+        num = std::min(info.numFlats, info.numSharps);
+    }
+    return 4.f * num;
+}
+
 inline float Score::drawKeysig(const DrawArgs &args, ConstScalePtr scale, bool treble, float y) const {
     const auto info = scale->getScoreInfo();
     float width = 0;
@@ -438,15 +590,13 @@ inline float Score::drawMusicNonNotes(const DrawArgs &args) const {
 }
 
 inline void Score::drawChordInfo(const DrawArgs &args, float x, const Comp::Chord &chord) const {
-    {
-        std::stringstream s;
-        s << chord.root;
-        nvgText(args.vg, x, yNoteInfo, s.str().c_str(), NULL);
-    }
-    {
-        std::stringstream s;
-        s << chord.inversion;
-        nvgText(args.vg, x, yNoteInfo + 8, s.str().c_str(), NULL);
+    // root is 1..8 and inversion 0..3, so one digit each
+    static const char *const digits[] = {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9"};
+    if (chord.root >= 0 && chord.root <= 9) {
+        nvgText(args.vg, x, yNoteInfo, digits[chord.root], NULL);
+    }
+    if (chord.inversion >= 0 && chord.inversion <= 9) {
+        nvgText(args.vg, x, yNoteInfo + 8, digits[chord.inversion], NULL);
     }
 #if 0
     std::stringstream s;
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <assert.h>
+
 #include <functional>
+#include <string>
+#include <vector>
 //#include "SqHelper.h"
 //#include "SqUI.h"
 #include "rack.hpp"
@@ -86,6 +90,51 @@ private:
     ::rack::engine::Module* const module;
 };
 
+/**
+ * menu item that sets a param to one value.
+ * A few of these make a radio group.
+ */
+struct SqMenuItem_ParamValue : ::rack::MenuItem {
+    SqMenuItem_ParamValue(::rack::engine::Module* mod, int id, float v) : paramId(id),
+                                                                          value(v),
+                                                                          module(mod) {
+    }
+
+    void onAction(const sq::EventAction& e) override {
+        APP->engine->setParamValue(module, paramId, value);
+        e.consume(this);
+    }
+
+    void step() override {
+        rightText = CHECKMARK(APP->engine->getParamValue(module, paramId) == value);
+    }
+
+    /**
+     * Adds a label, then one of these for each value.
+     */
+    static void addGroup(::rack::ui::Menu* menu,
+                         ::rack::engine::Module* mod,
+                         const char* title,
+                         int id,
+                         const std::vector<float>& values,
+                         const std::vector<std::string>& labels) {
+        assert(values.size() == labels.size());
+        ::rack::ui::MenuLabel* label = new ::rack::ui::MenuLabel();
+        label->text = title;
+        menu->addChild(label);
+        for (size_t i = 0; i < values.size(); ++i) {
+            SqMenuItem_ParamValue* item = new SqMenuItem_ParamValue(mod, id, values[i]);
+            item->text = labels[i];
+            menu->addChild(item);
+        }
+    }
+
+private:
+    const int paramId;
+    const float value;
+    ::rack::engine::Module* const module;
+};
+
 struct SqMenuItem_BooleanParam : ::rack::MenuItem {
     SqMenuItem_BooleanParam(::rack::ParamWidget* widget) : widget(widget) {
     }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <chrono>
+
+/**
+ * Minimal benchmark helper for perfTest.
+ * Runs a lambda many times and prints the average time per call.
+ */
+class MeasureTime {
+public:
+    /**
+     * @return average nanoseconds per call
+     */
+    template <typename F>
+    static double run(const char* name, int iterations, F&& func) {
+        // one un-timed call to warm the caches
+        func();
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            func();
+        }
+        const auto end = std::chrono::high_resolution_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+        printf("perf: %s: %.1f ns\n", name, ns);
+        fflush(stdout);
+        return ns;
+    }
+};
@@ -11,6 +11,7 @@ extern void testNotes();
 extern void testScale();
 extern void testScaleNotes();
 extern void testHarmonyComposite();
+extern void testHarmonyArpComposite();
 extern void testKeysig();
 extern void specialDumpList();
 extern void testProgressions();
@@ -18,11 +19,16 @@ extern void testNoteBuffer();
 // extern void testNoteBufferSorter();
 extern void testArpegPlayer();
 extern void testArpegPlayer2();
+extern void testArpegPatterns();
+extern void testArpegProgram();
 extern void testArpegComposite();
 extern void testArpegRhythmPlayer();
 extern void testSeqClock();
 extern void testGateDelay();
+extern void testSqRandom();
 extern void testHarmonyChordsRandom();
+extern void testChordN();
+extern void perfTest();
 
 int main(const char**, int) {
 #if 0
@@ -31,7 +37,10 @@ int main(const char**, int) {
     testGateDelay();
     testSeqClock();
     testNoteBuffer();
+    testSqRandom();
 
+    testArpegPatterns();
+    testArpegProgram();
     testArpegPlayer2();
     testArpegPlayer();
     testArpegRhythmPlayer();
@@ -50,9 +59,15 @@ int main(const char**, int) {
     testHarmonySong();
     testHarmonyChords();
     testHarmonyChordsRandom();
+    testChordN();
 #endif
     testHarmonyComposite();
+    testHarmonyArpComposite();
     printf("put back test progression?\n");
 
+#ifndef _DEBUG
+    perfTest();
+#endif
+
 #endif
 }
\ No newline at end of file
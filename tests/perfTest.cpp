@@ -0,0 +1,607 @@
+#include "ArpegPlayer.h"
+#include "Arpeggiator.h"
+#include "Chord4.h"
+#include "Chord4Manager.h"
+#include "GateDelay.h"
+#include "Harmony.h"
+#include "HarmonyArp.h"
+#include "HarmonyChords.h"
+#include "HarmonySong.h"
+#include "KeysigOld.h"
+#include "MeasureTime.h"
+#include "NoteBuffer.h"
+#include "Options.h"
+#include "SeqClock.h"
+#include "Style.h"
+#include "TestComposite.h"
+
+static Options makeOptions() {
+    auto keysig = std::make_shared<KeysigOld>(Roots::C);
+    auto style = std::make_shared<Style>();
+    Options o(keysig, style);
+    return o;
+}
+
+// time a chord search on each voice count we instantiate.
+template <int N>
+static void testFindChordN(const char* name, Style::VoiceLeading voiceLeading = Style::VoiceLeading::RULES_ONLY) {
+    auto options = makeOptions();
+    options.style->setVoiceLeading(voiceLeading);
+    ChordNManager<N> mgr(options);
+    const int roots[] = {1, 4, 5, 1, 6, 2, 5, 3, 6, 4, 7};
+    const int numRoots = sizeof(roots) / sizeof(roots[0]);
+
+    const ChordN<N>* a = HarmonyChordsN<N>::findChord(false, options, mgr, roots[0]);
+    const ChordN<N>* b = HarmonyChordsN<N>::findChord(false, options, mgr, *a, roots[1]);
+    int index = 2;
+    MeasureTime::run(name, 200, [&]() {
+        const ChordN<N>* c = HarmonyChordsN<N>::findChord(false, options, mgr, *a, *b, roots[index]);
+        a = b;
+        b = c;
+        if (++index >= numRoots) {
+            index = 0;
+        }
+    });
+}
+
+// same progression as above, but keeping the best k voicings.
+static void testFindAlternatives(int k) {
+    auto options = makeOptions();
+    Chord4Manager mgr(options);
+    const int roots[] = {1, 4, 5, 1, 6, 2, 5, 3, 6, 4, 7};
+    const int numRoots = sizeof(roots) / sizeof(roots[0]);
+
+    const Chord4* a = HarmonyChords::findChord(false, options, mgr, roots[0]);
+    const Chord4* b = HarmonyChords::findChord(false, options, mgr, *a, roots[1]);
+    HarmonyChords::Alternatives alternatives(k);
+    int index = 2;
+    char name[64];
+    snprintf(name, sizeof(name), "findAlternatives k=%d", k);
+    MeasureTime::run(name, 200, [&]() {
+        HarmonyChords::findAlternatives(false, options, mgr, a, b, roots[index], alternatives);
+        a = b;
+        b = alternatives.get(0);
+        if (++index >= numRoots) {
+            index = 0;
+        }
+    });
+}
+
+// a melody instead of roots, for comparison with findChord 4 voices.
+static void testFindChordForMelody() {
+    auto options = makeOptions();
+    Chord4Manager mgr(options);
+    const int melody[] = {72, 74, 76, 77, 79, 77, 76, 74, 71, 72, 79};
+    const int numNotes = sizeof(melody) / sizeof(melody[0]);
+
+    const Chord4* a = HarmonyChords::findChordForMelody(false, options, mgr, nullptr, nullptr, melody[0]);
+    const Chord4* b = HarmonyChords::findChordForMelody(false, options, mgr, nullptr, a, melody[1]);
+    int index = 2;
+    MeasureTime::run("findChordForMelody", 200, [&]() {
+        const Chord4* c = HarmonyChords::findChordForMelody(false, options, mgr, a, b, melody[index]);
+        a = b;
+        b = c;
+        if (++index >= numNotes) {
+            index = 0;
+        }
+    });
+}
+
+// recognize voicings from their pitches, half from the tables, half not.
+static void testRecognize() {
+    auto options = makeOptions();
+    Chord4Manager mgr(options);
+    const int pitches[][4] = {
+        {48, 52, 55, 60},
+        {24, 28, 31, 36},
+        {43, 50, 55, 59},
+        {60, 62, 64, 65}};
+    int index = 0;
+    int found = 0;
+    MeasureTime::run("recognize", 200, [&]() {
+        found += mgr.recognize(pitches[index]).root;
+        index = (index + 1) & 3;
+    });
+    assert(found > 0);
+}
+
+// the 100 best harmonizations of a 64 chord song
+static void testGenerateBest() {
+    auto options = makeOptions();
+    int progression[65];
+    const int roots[] = {1, 4, 5, 1, 6, 2, 5, 3};
+    for (int i = 0; i < 64; ++i) {
+        progression[i] = roots[i % 8];
+    }
+    progression[64] = 0;
+    HarmonySong song(options, progression);
+    size_t bytes = 0;
+    int found = 0;
+    MeasureTime::run("generateBest n=100, 64 chords", 1, [&]() {
+        found = int(song.generateBest(options, 100, bytes).size());
+    });
+    printf("perf:   found %d, used %.1f MB\n", found, bytes / (1024.0 * 1024.0));
+}
+
+// a 1000 chord song: search it all, then edit one root at a time.
+static void testEditRoot() {
+    auto options = makeOptions();
+    std::vector<int> progression;
+    const int roots[] = {1, 4, 5, 1, 6, 2, 5, 3};
+    for (int i = 0; i < 1000; ++i) {
+        progression.push_back(roots[i % 8]);
+    }
+    progression.push_back(0);
+    HarmonySong song(options, progression.data());
+
+    MeasureTime::run("generateOptimal 1000 chords", 1, [&]() {
+        song.generateOptimal(options);
+    });
+    int index = 0;
+    int searched = 0;
+    int edits = 0;
+    MeasureTime::run("editRoot 1000 chords", 500, [&]() {
+        index = (index + 337) % 1000;
+        song.editRoot(options, index, roots[(index + 3) % 8]);
+        searched += song._stepsSearched();
+        ++edits;
+    });
+    printf("perf:   %.1f steps searched per edit\n", double(searched) / edits);
+}
+
+// building the chord lists is mostly chord membership and doubling tests,
+// which should cost the same for triads and seventh chords.
+static void testBuildManager(const char* name, bool seventh) {
+    auto options = makeOptions();
+    options.style->setSeventhChords(seventh);
+    MeasureTime::run(name, 10, [&]() {
+        Chord4Manager mgr(options);
+        assert(mgr.isValid());
+    });
+}
+
+static void testFromString() {
+    auto options = makeOptions();
+    MeasureTime::run("fromString", 1000, [&]() {
+        Chord4Ptr chord = Chord4::fromString(options, 6, "E2A2C3A3");
+        assert(chord);
+    });
+
+    Chord4Manager mgr(options);
+    Chord4::Packed voicing = 0;
+    Chord4::parse("E2A2C3A3", voicing);
+    int ranks = 0;
+    MeasureTime::run("manager find", 1000, [&]() {
+        ranks += mgr.find(6, voicing);
+    });
+    // use the result, so it doesn't get optimized away
+    printf("perf:   rank total %d\n", ranks);
+}
+
+// per sample cost of the Harmony composite when the input isn't making new chords
+static void testHarmonyProcess() {
+    using Comp = Harmony<TestComposite>;
+    Comp h;
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);
+    const TestComposite::ProcessArgs args;
+    h.process(args);
+
+    MeasureTime::run("harmony process static input", 100000, [&]() {
+        h.process(args);
+    });
+
+    // wiggle the input, but not enough to change the note
+    float x = 0;
+    MeasureTime::run("harmony process moving input", 100000, [&]() {
+        x += .001f;
+        if (x > .02f) {
+            x = 0;
+        }
+        h.inputs[Comp::CV_INPUT].setVoltage(x, 0);
+        h.process(args);
+    });
+}
+
+// going back and forth between two keys. After the first time the tables
+// come from the cache, so this is mostly remapping the chord history.
+static void testHarmonyKeyChange() {
+    using Comp = Harmony<TestComposite>;
+    Comp h;
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(5.f / 12.f, 0);
+    const TestComposite::ProcessArgs args;
+    int key = 0;
+    MeasureTime::run("harmony key change", 100, [&]() {
+        key = (key == 0) ? 7 : 0;
+        h.params[Comp::KEY_PARAM].value = float(key);
+        for (int i = 0; i < 32; ++i) {
+            h.process(args);
+        }
+    });
+}
+
+// poly: every channel wiggles its input, but only one of them changes note each time
+static void testHarmonyPoly(int numChannels) {
+    using Comp = Harmony<TestComposite>;
+    Comp h;
+    h.inputs[Comp::CV_INPUT].channels = numChannels;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h.outputs[Comp::TENOR_OUTPUT].channels = 1;
+    h.outputs[Comp::ALTO_OUTPUT].channels = 1;
+    h.outputs[Comp::SOPRANO_OUTPUT].channels = 1;
+    const TestComposite::ProcessArgs args;
+    h.process(args);
+
+    const float degrees[] = {0, 5.f / 12.f, 7.f / 12.f, 0, 9.f / 12.f, 2.f / 12.f, 7.f / 12.f};
+    int counter = 0;
+    int degree = 0;
+    float wiggle = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "harmony process %d channels", numChannels);
+    const double ns = MeasureTime::run(name, 20000, [&]() {
+        wiggle = (wiggle > .01f) ? 0 : wiggle + .001f;
+        for (int c = 0; c < numChannels; ++c) {
+            h.inputs[Comp::CV_INPUT].setVoltage(degrees[(degree + c) % 7] + wiggle, c);
+        }
+        // a new chord on one channel every 100 samples
+        if (++counter > 100) {
+            counter = 0;
+            ++degree;
+        }
+        h.process(args);
+    });
+    printf("perf:   %.1f ns per channel\n", ns / numChannels);
+}
+
+// Harmony patched into the Arpeggiator with a poly cable, vs the fused composite.
+// A new chord every 100 samples, a clock every 50.
+static void testHarmonyToArp() {
+    const float degrees[] = {0, 5.f / 12.f, 7.f / 12.f, 0, 9.f / 12.f, 2.f / 12.f, 7.f / 12.f};
+    const TestComposite::ProcessArgs args;
+    {
+        using HComp = Harmony<TestComposite>;
+        using AComp = Arpeggiator<TestComposite>;
+        HComp h;
+        AComp arp;
+        h.inputs[HComp::CV_INPUT].channels = 1;
+        h.outputs[HComp::SOPRANO_OUTPUT].channels = 1;  // all four voices on one cable
+        arp.inputs[AComp::CV_INPUT].channels = 4;
+        arp.inputs[AComp::GATE_INPUT].channels = 1;
+        arp.inputs[AComp::GATE_INPUT].setVoltage(10, 0);
+        arp.inputs[AComp::CLOCK_INPUT].channels = 1;
+        arp.params[AComp::GATE_DELAY_PARAM].value = 1;
+        int counter = 0;
+        int degree = 0;
+        MeasureTime::run("harmony to arp by cable", 100000, [&]() {
+            if (++counter >= 100) {
+                counter = 0;
+                degree = (degree + 1) % 7;
+            }
+            h.inputs[HComp::CV_INPUT].setVoltage(degrees[degree], 0);
+            arp.inputs[AComp::CLOCK_INPUT].setVoltage((counter % 50) < 25 ? 10.f : 0.f, 0);
+            h.process(args);
+            for (int i = 0; i < 4; ++i) {
+                arp.inputs[AComp::CV_INPUT].setVoltage(h.outputs[HComp::SOPRANO_OUTPUT].getVoltage(i), i);
+            }
+            arp.process(args);
+        });
+    }
+    {
+        using Comp = HarmonyArp<TestComposite>;
+        Comp h;
+        h.inputs[Comp::CV_INPUT].channels = 1;
+        h.outputs[Comp::SOPRANO_OUTPUT].channels = 1;
+        h.inputs[Comp::CLOCK_INPUT].channels = 1;
+        int counter = 0;
+        int degree = 0;
+        MeasureTime::run("harmony to arp fused", 100000, [&]() {
+            if (++counter >= 100) {
+                counter = 0;
+                degree = (degree + 1) % 7;
+            }
+            h.inputs[Comp::CV_INPUT].setVoltage(degrees[degree], 0);
+            h.inputs[Comp::CLOCK_INPUT].setVoltage((counter % 50) < 25 ? 10.f : 0.f, 0);
+            h.process(args);
+        });
+    }
+}
+
+// 16 arps in one poly module, vs 16 mono modules. A clock every 50 samples.
+static void testPolyArp() {
+    using Comp = Arpeggiator<TestComposite>;
+    const TestComposite::ProcessArgs args;
+    auto setup = [](Comp& arp, int channels) {
+        arp.inputs[Comp::CV_INPUT].channels = channels;
+        arp.inputs[Comp::GATE_INPUT].channels = channels;
+        arp.inputs[Comp::CLOCK_INPUT].channels = 1;
+        arp.outputs[Comp::CV_OUTPUT].channels = 1;
+        arp.outputs[Comp::GATE_OUTPUT].channels = 1;
+        for (int i = 0; i < channels; ++i) {
+            arp.inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+            arp.inputs[Comp::GATE_INPUT].setVoltage(10, i);
+        }
+    };
+    {
+        std::vector<std::unique_ptr<Comp>> arps;
+        for (int i = 0; i < 16; ++i) {
+            arps.push_back(std::make_unique<Comp>());
+            setup(*arps.back(), 1);
+        }
+        int counter = 0;
+        MeasureTime::run("16 mono arpeggiators", 20000, [&]() {
+            counter = (counter + 1) % 50;
+            const float clock = (counter < 25) ? 10.f : 0.f;
+            for (auto& arp : arps) {
+                arp->inputs[Comp::CLOCK_INPUT].setVoltage(clock, 0);
+                arp->process(args);
+            }
+        });
+    }
+    {
+        Comp arp;
+        setup(arp, 16);
+        arp.params[Comp::POLY_PARAM].value = 1;
+        int counter = 0;
+        MeasureTime::run("one arpeggiator, 16 poly arps", 20000, [&]() {
+            counter = (counter + 1) % 50;
+            arp.inputs[Comp::CLOCK_INPUT].setVoltage((counter < 25) ? 10.f : 0.f, 0);
+            arp.process(args);
+        });
+        assert(arp.getNumArps() == 16);
+    }
+}
+
+// Just the gate input: 16 channels held, one of them flickering now and then, no clock.
+static void testArpGates(bool delay) {
+    using Comp = Arpeggiator<TestComposite>;
+    const TestComposite::ProcessArgs args;
+    Comp arp;
+    arp.inputs[Comp::CV_INPUT].channels = 16;
+    arp.inputs[Comp::GATE_INPUT].channels = 16;
+    arp.params[Comp::GATE_DELAY_PARAM].value = delay ? 1.f : 0.f;
+    for (int i = 0; i < 16; ++i) {
+        arp.inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+        arp.inputs[Comp::GATE_INPUT].setVoltage(10, i);
+    }
+    int counter = 0;
+    MeasureTime::run(delay ? "arp 16 gates, gate delay" : "arp 16 gates, no delay", 100000, [&]() {
+        counter = (counter + 1) % 500;
+        arp.inputs[Comp::GATE_INPUT].setVoltage((counter < 250) ? 10.f : 0.f, counter % 16);
+        arp.process(args);
+    });
+}
+
+/**
+ * Notes the way they come from other modules: cv with the gate, a little ahead,
+ * a few samples late, the same pitch again, and slewed. Prints how long gates were
+ * held and how many came out before their cv got there, then times 16 channels.
+ */
+static void testGateDelayLatency(const char* name, GateDelay::Mode mode) {
+    const int cvLags[] = {0, 0, -2, 1, 2, 3, 0, 1, -1, 0};
+    const int numLags = sizeof(cvLags) / sizeof(cvLags[0]);
+    const int gateOn = 200;
+    const int noteLength = 300;
+    const int slewSamples = 20;
+
+    GateDelay gd;
+    gd.setMode(mode);
+    Input gate;
+    Input cv;
+    float cvFrom = 0;
+    float cvTo = 0;
+    int totalLatency = 0;
+    int notes = 0;
+    int wrong = 0;
+    for (int note = 0; note < 1000; ++note) {
+        const int lag = cvLags[note % numLags];
+        const bool samePitch = (note % 7) == 3;
+        const bool slew = (note % 11) == 5;
+        cvFrom = cvTo;
+        if (!samePitch) {
+            cvTo = float((note * 5) % 24) / 12.f;
+        }
+        int latency = -1;
+        for (int i = 0; i < noteLength; ++i) {
+            float v = (i >= gateOn + lag) ? cvTo : cvFrom;
+            if (slew) {
+                const float t = std::min(1.f, std::max(0.f, float(i - gateOn - lag) / slewSamples));
+                v = cvFrom + t * (cvTo - cvFrom);
+            }
+            cv.setVoltage(v, 0);
+            gate.setVoltage((i >= gateOn) ? 10.f : 0.f, 0);
+            gd.process(gate, 1, &cv, 1);
+            if (latency < 0 && i >= gateOn && gd.getGate(0)) {
+                latency = i - gateOn;
+                if (std::abs(v - cvTo) > .01f) {
+                    ++wrong;
+                }
+            }
+        }
+        if (latency >= 0) {
+            totalLatency += latency;
+            ++notes;
+        }
+    }
+    printf("%s: %d notes, average latency %.2f samples, %d wrong pitch\n", name, notes, double(totalLatency) / notes, wrong);
+
+    Input gates;
+    Input cvs;
+    for (int i = 0; i < 16; ++i) {
+        gates.setVoltage(10, i);
+        cvs.setVoltage(float(i), i);
+    }
+    int counter = 0;
+    MeasureTime::run(name, 100000, [&]() {
+        counter = (counter + 1) % 500;
+        gates.setVoltage((counter < 250) ? 10.f : 0.f, counter % 16);
+        cvs.setVoltage(float(counter), counter % 16);
+        gd.process(gates, 16, &cvs, 16);
+    });
+}
+
+// 64 samples of a clock with 50 sample period, and no reset. Per sample or as a block.
+static void testSeqClockBlock(bool block) {
+    const int blockSize = 64;
+    float clock[blockSize * 50];
+    float reset[blockSize * 50] = {0};
+    for (int i = 0; i < blockSize * 50; ++i) {
+        clock[i] = ((i % 50) < 25) ? 10.f : 0.f;
+    }
+    SeqClock ck;
+    SeqClock::Event events[blockSize];
+    int offset = 0;
+    int clocks = 0;
+    MeasureTime::run(block ? "seq clock, 64 sample block" : "seq clock, 64 samples one at a time", 20000, [&]() {
+        offset = (offset + blockSize) % (blockSize * 50);
+        if (block) {
+            const int n = ck.updateBlock(clock + offset, reset + offset, blockSize, true, events);
+            for (int i = 0; i < n; ++i) {
+                clocks += events[i].results.didClock;
+            }
+        } else {
+            for (int i = 0; i < blockSize; ++i) {
+                clocks += ck.updateOnce(clock[offset + i], true, reset[offset + i]).didClock;
+            }
+        }
+    });
+    assert(clocks > 0);
+}
+
+// Shuffle mode, armed all the time, so every 16th clock shuffles.
+static void testArpShuffle(bool noRepeat) {
+    NoteBuffer nb(16);
+    for (int i = 0; i < 16; ++i) {
+        nb.push_back(float(i), 0, i);
+    }
+    ArpegPlayer player(&nb);
+    player.setMode(ArpegPlayer::Mode::SHUFFLE);
+    player.setNoRepeat(noRepeat);
+    MeasureTime::run(noRepeat ? "arp clock, shuffle 16 no repeat" : "arp clock, shuffle 16", 100000, [&]() {
+        player.armReShuffle();
+        player.clock();
+    });
+}
+
+// A full buffer, with notes coming and going on 16 channels.
+static void testNoteBuffer(int capacity) {
+    NoteBuffer nb(capacity);
+    for (int i = 0; i < capacity; ++i) {
+        nb.push_back(float(i), 0, i % 16);
+    }
+    int channel = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "note buffer remove and push, %d notes", capacity);
+    MeasureTime::run(name, 100000, [&]() {
+        nb.removeForChannel(channel);
+        nb.push_back(1, 0, channel);
+        nb.push_back(2, 0, channel);  // full, so the oldest falls off
+        channel = (channel + 1) % 16;
+    });
+}
+
+// One note changes, then the player refills on the next clock. Up mode, so it's all sorting.
+static void testArpRefill(int capacity) {
+    NoteBuffer nb(capacity);
+    ArpegPlayer player(&nb);
+    for (int i = 0; i < capacity; ++i) {
+        nb.push_back(float((i * 7) % capacity), 0, i % 16);
+    }
+    player.clock();
+    int channel = 0;
+    float pitch = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "arp refill on note change, %d notes", capacity);
+    MeasureTime::run(name, 100000, [&]() {
+        nb.removeForChannel(channel);
+        pitch = (pitch > 10) ? 0 : pitch + .37f;
+        nb.push_back(pitch, 0, channel);
+        channel = (channel + 1) % 16;
+        player.clock();
+    });
+}
+
+// mode CV moving while the clock runs
+static void testArpModeSwitch(int capacity) {
+    NoteBuffer nb(capacity);
+    ArpegPlayer player(&nb);
+    for (int i = 0; i < capacity; ++i) {
+        nb.push_back(float((i * 7) % capacity), 0, i);
+    }
+    const int numModes = int(ArpegPlayer::modes().size());
+    int mode = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "arp mode switch, %d notes", capacity);
+    MeasureTime::run(name, 100000, [&]() {
+        mode = (mode + 1) % numModes;
+        if (ArpegPlayer::Mode(mode) == ArpegPlayer::Mode::SHUFFLE) {
+            mode = 0;
+        }
+        player.setMode(ArpegPlayer::Mode(mode));
+        player.clock();
+    });
+}
+
+// a user pattern should clock as fast as a built-in mode
+static void testArpProgram(const char* name, const char* pattern) {
+    NoteBuffer nb(8);
+    ArpegPlayer player(&nb);
+    for (int i = 0; i < 8; ++i) {
+        nb.push_back(float(i), 0, i);
+    }
+    std::string error;
+    std::unique_ptr<ArpegProgram> program;
+    if (pattern) {
+        program.reset(ArpegProgram::compile(pattern, error));
+        player.setProgram(program.get());
+    } else {
+        player.setMode(ArpegPlayer::Mode::UPDOWN);
+    }
+    MeasureTime::run(name, 100000, [&]() {
+        player.clock();
+    });
+}
+
+void perfTest() {
+    testFindChordN<3>("findChord 3 voices");
+    testFindChordN<4>("findChord 4 voices");
+    testFindChordN<5>("findChord 5 voices");
+    testFindChordN<6>("findChord 6 voices");
+    testFindChordN<4>("findChord 4 voices weighted motion", Style::VoiceLeading::WEIGHTED);
+    testFindChordN<4>("findChord 4 voices smoothest", Style::VoiceLeading::SMOOTHEST);
+    testFindAlternatives(1);
+    testFindAlternatives(4);
+    testFindAlternatives(HarmonyChords::Alternatives::maxSize);
+    testFindChordForMelody();
+    testRecognize();
+    testBuildManager("build manager triads", false);
+    testBuildManager("build manager sevenths", true);
+    testFromString();
+    testGenerateBest();
+    testEditRoot();
+    testHarmonyProcess();
+    testHarmonyKeyChange();
+    testHarmonyPoly(1);
+    testHarmonyPoly(4);
+    testHarmonyPoly(16);
+    testHarmonyToArp();
+    testPolyArp();
+    testNoteBuffer(32);
+    testNoteBuffer(NoteBuffer::maxCapacity);
+    testArpRefill(32);
+    testArpRefill(NoteBuffer::maxCapacity);
+    testArpModeSwitch(32);
+    testArpModeSwitch(NoteBuffer::maxCapacity);
+    testArpGates(false);
+    testArpGates(true);
+    testGateDelayLatency("gate delay fixed", GateDelay::Mode::FIXED);
+    testGateDelayLatency("gate delay adaptive", GateDelay::Mode::ADAPTIVE);
+    testSeqClockBlock(false);
+    testSeqClockBlock(true);
+    testArpShuffle(false);
+    testArpShuffle(true);
+    testArpProgram("arp clock, up+down mode", nullptr);
+    testArpProgram("arp clock, up+down pattern", "up -2 -3 -4 -5 -6 -7");
+}
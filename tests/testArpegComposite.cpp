@@ -404,6 +404,67 @@ static void testMonoGate() {
     assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), 10);
 }
 
+// with a mono gate held, dropping a cv channel takes its note out
+static void testMonoGateLoseChannel() {
+    auto arp = make();
+    arp->inputs[Comp::CV_INPUT].channels = 3;
+    arp->inputs[Comp::GATE_INPUT].channels = 1;
+    arp->inputs[Comp::CLOCK_INPUT].channels = 1;
+    for (int i = 0; i < 3; ++i) {
+        arp->inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+    }
+    arp->inputs[Comp::GATE_INPUT].setVoltage(10, 0);
+    arp->process(TestComposite::ProcessArgs());
+
+    arp->inputs[Comp::CV_INPUT].channels = 2;
+    for (int i = 0; i < 6; ++i) {
+        clockCycle(arp);
+        assertLT(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), 2);
+    }
+}
+
+// gates a few samples apart go in as one chord, at the end of the window
+static void testCaptureWindow() {
+    auto arp = make();
+    connectInputs(arp, 3);
+    arp->params[Comp::CAPTURE_PARAM].value = 1;  // 44 samples
+    const NoteBuffer& nb = arp->getNoteBuffer(0);
+    const unsigned changes = nb.getChangeCount();
+    auto args = TestComposite::ProcessArgs();
+
+    for (int ch = 0; ch < 3; ++ch) {
+        arp->inputs[Comp::CV_INPUT].setVoltage(float(ch), ch);
+        arp->inputs[Comp::GATE_INPUT].setVoltage(10, ch);
+        for (int i = 0; i < 10; ++i) {
+            arp->process(args);
+        }
+    }
+    assertEQ(nb.size(), 0);
+
+    // cv moving before the window closes is fine
+    arp->inputs[Comp::CV_INPUT].setVoltage(5, 0);
+    for (int i = 0; i < 14; ++i) {
+        arp->process(args);
+    }
+    assertEQ(nb.size(), 0);
+    arp->process(args);
+    assertEQ(nb.size(), 3);
+    assertEQ(nb.getChangeCount(), changes + 1);
+    assertEQ(nb.at(0).cv1, 5);
+
+    // a gate that goes off and on comes back with its new pitch
+    arp->inputs[Comp::GATE_INPUT].setVoltage(0, 1);
+    arp->process(args);
+    arp->inputs[Comp::CV_INPUT].setVoltage(7, 1);
+    arp->inputs[Comp::GATE_INPUT].setVoltage(10, 1);
+    for (int i = 0; i < 50; ++i) {
+        arp->process(args);
+    }
+    assertEQ(nb.size(), 3);
+    assertEQ(nb.getChangeCount(), changes + 2);
+    assertEQ(nb.at(2).cv1, 7);
+}
+
 static void testTriggerDelay(bool delayOn) {
     auto arp = make();
     connectInputs(arp, 16);
@@ -579,6 +640,157 @@ static void testShuffleCV() {
     
 }
 
+// 8 channels in, 4 per arp. Each arp plays its own notes on its own channel.
+static void testPoly() {
+    auto arp = make();
+    connectInputs(arp, 8);
+    arp->outputs[Comp::CV_OUTPUT].channels = 1;
+    arp->outputs[Comp::GATE_OUTPUT].channels = 1;
+    arp->params[Comp::POLY_PARAM].value = 4;
+    for (int i = 0; i < 8; ++i) {
+        arp->inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+        arp->inputs[Comp::GATE_INPUT].setVoltage(10, i);
+    }
+
+    for (int step = 0; step < 8; ++step) {
+        clockCycle(arp);
+        assertEQ(arp->getNumArps(), 2);
+        assertEQ(arp->outputs[Comp::CV_OUTPUT].getChannels(), 2);
+        assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), float(step % 4));
+        assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(1), float(4 + step % 4));
+        assertEQ(arp->outputs[Comp::GATE_OUTPUT].getVoltage(1), cGateOutHi);
+    }
+
+    // second group lets go, so second arp goes quiet
+    for (int i = 4; i < 8; ++i) {
+        arp->inputs[Comp::GATE_INPUT].setVoltage(0, i);
+    }
+    clockCycle(arp);
+    assertEQ(arp->outputs[Comp::GATE_OUTPUT].getVoltage(0), cGateOutHi);
+    assertEQ(arp->outputs[Comp::GATE_OUTPUT].getVoltage(1), 0);
+}
+
+static int totalNotes(ArpPtr arp) {
+    int total = 0;
+    for (int i = 0; i < Comp::maxArps; ++i) {
+        total += arp->getNoteBuffer(i).size();
+    }
+    return total;
+}
+
+// changing the grouping with hold on moves the notes, doesn't copy them
+static void testPolyRegroupHold() {
+    auto arp = make();
+    connectInputs(arp, 4);
+    arp->params[Comp::HOLD_PARAM].value = 1;
+    arp->params[Comp::POLY_PARAM].value = 1;
+    for (int i = 0; i < 4; ++i) {
+        arp->inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+        arp->inputs[Comp::GATE_INPUT].setVoltage(10, i);
+    }
+    clockCycle(arp);
+    assertEQ(arp->getNumArps(), 4);
+    assertEQ(totalNotes(arp), 4);
+
+    arp->params[Comp::POLY_PARAM].value = 2;
+    clockCycle(arp);
+    clockCycle(arp);
+    assertEQ(arp->getNumArps(), 2);
+    assertEQ(arp->getNoteBuffer(0).size(), 2);
+    assertEQ(arp->getNoteBuffer(1).size(), 2);
+    assertEQ(totalNotes(arp), 4);
+}
+
+// arps that go away while holding don't keep their notes after hold is off
+static void testPolyDroppedArpHold() {
+    auto arp = make();
+    connectInputs(arp, 4);
+    arp->params[Comp::HOLD_PARAM].value = 1;
+    arp->params[Comp::POLY_PARAM].value = 1;
+    for (int i = 0; i < 4; ++i) {
+        arp->inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+        arp->inputs[Comp::GATE_INPUT].setVoltage(10, i);
+    }
+    clockCycle(arp);
+    assertEQ(arp->getNumArps(), 4);
+
+    // down to two arps, let go of everything, hold off
+    connectInputs(arp, 2);
+    for (int i = 0; i < 4; ++i) {
+        arp->inputs[Comp::GATE_INPUT].setVoltage(0, i);
+    }
+    clockCycle(arp);
+    assertEQ(arp->getNumArps(), 2);
+    arp->params[Comp::HOLD_PARAM].value = 0;
+    clockCycle(arp);
+
+    // back to four, nothing playing
+    connectInputs(arp, 4);
+    clockCycle(arp);
+    assertEQ(arp->getNumArps(), 4);
+    assertEQ(totalNotes(arp), 0);
+    for (int i = 0; i < 4; ++i) {
+        assertEQ(arp->outputs[Comp::GATE_OUTPUT].getVoltage(i), 0);
+    }
+}
+
+// with a poly clock, each arp only moves on its own clock
+static void testPolyClock() {
+    auto arp = make();
+    connectInputs(arp, 4);
+    arp->inputs[Comp::CLOCK_INPUT].channels = 2;
+    arp->params[Comp::POLY_PARAM].value = 2;
+    for (int i = 0; i < 4; ++i) {
+        arp->inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+        arp->inputs[Comp::GATE_INPUT].setVoltage(10, i);
+    }
+    auto args = TestComposite::ProcessArgs();
+
+    // clock both
+    arp->inputs[Comp::CLOCK_INPUT].setVoltage(10, 0);
+    arp->inputs[Comp::CLOCK_INPUT].setVoltage(10, 1);
+    arp->process(args);
+    assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), 0);
+    assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(1), 2);
+
+    // now just the first one
+    arp->inputs[Comp::CLOCK_INPUT].setVoltage(0, 0);
+    arp->process(args);
+    arp->inputs[Comp::CLOCK_INPUT].setVoltage(10, 0);
+    arp->process(args);
+    assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), 1);
+    assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(1), 2);
+}
+
+static void testPattern() {
+    auto arp = make();
+    connectInputs(arp, 3);
+    for (int i = 0; i < 3; ++i) {
+        arp->inputs[Comp::CV_INPUT].setVoltage(float(i), i);
+        arp->inputs[Comp::GATE_INPUT].setVoltage(10, i);
+    }
+
+    std::string error;
+    assert(!arp->setPattern("1 fred", error));
+    assertEQ(error, "don't understand fred");
+    assert(arp->setPattern("3 +oct 1", error));
+    assertEQ(arp->getPattern(), "3 +oct 1");
+
+    const float expected[] = {2, 1, 2, 1};
+    for (float pitch : expected) {
+        clockCycle(arp);
+        assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), pitch);
+    }
+
+    // empty goes back to the mode, carrying on from the note we were about to play
+    assert(arp->setPattern("", error));
+    assertEQ(arp->getPattern(), "");
+    clockCycle(arp);
+    assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), 2);
+    clockCycle(arp);
+    assertEQ(arp->outputs[Comp::CV_OUTPUT].getVoltage(0), 0);
+}
+
 static void testPullCable() {
     auto arp = make();
     connectInputs(arp, 1);
@@ -620,12 +832,19 @@ void testArpegComposite() {
     testReset(false);
     testReset(true);  // nord mode
     testMonoGate();
+    testMonoGateLoseChannel();
+    testCaptureWindow();
     testTriggerDelay(false);
     testTriggerDelay(true);
     testReleaseMidClock(false);
     testReleaseMidClock(true);
     testStartMidClock(false);
     testShuffleCV();
+    testPoly();
+    testPolyClock();
+    testPolyRegroupHold();
+    testPolyDroppedArpHold();
+    testPattern();
 
     SQWARN("!!!! put back the pull cable test");
     //testPullCable();
@@ -0,0 +1,83 @@
+
+#include "ArpegPatterns.h"
+#include "ArpegPlayer.h"
+#include "asserts.h"
+
+static void assertPattern(ArpegPlayer::Mode mode, const int* expected, int numNotes, int size) {
+    const ArpegPatterns::Pattern& pattern = ArpegPatterns::get(int(mode), numNotes);
+    assertEQ(pattern.size, size);
+    for (int i = 0; i < size; ++i) {
+        assertEQ(pattern.steps[i], expected[i]);
+    }
+}
+
+static void testKnownPatterns() {
+    const int upDown[] = {0, 1, 2, 3, 2, 1};
+    assertPattern(ArpegPlayer::Mode::UPDOWN, upDown, 4, 6);
+    const int downUp[] = {3, 2, 1, 0, 1, 2};
+    assertPattern(ArpegPlayer::Mode::DOWNUP, downUp, 4, 6);
+    const int upDownDbl[] = {0, 1, 2, 2, 1, 0};
+    assertPattern(ArpegPlayer::Mode::UP_DOWN_DBL, upDownDbl, 3, 6);
+    const int insideOutOdd[] = {2, 3, 1, 4, 0};
+    assertPattern(ArpegPlayer::Mode::INSIDE_OUT, insideOutOdd, 5, 5);
+    const int insideOutEven[] = {2, 1, 3, 0};
+    assertPattern(ArpegPlayer::Mode::INSIDE_OUT, insideOutEven, 4, 4);
+    const int outsideIn[] = {4, 0, 3, 1, 2};
+    assertPattern(ArpegPlayer::Mode::OUTSIDE_IN, outsideIn, 5, 5);
+    const int repeatTop[] = {3, 0, 3, 1, 3, 2};
+    assertPattern(ArpegPlayer::Mode::REPEAT_TOP, repeatTop, 4, 6);
+    const int one[] = {0};
+    assertPattern(ArpegPlayer::Mode::REPEAT_BOTTOM, one, 1, 1);
+    assertPattern(ArpegPlayer::Mode::UPDOWN, one, 1, 1);
+}
+
+// every pattern, every size: steps in range, and firstStep finds them
+static void testAllSizes() {
+    for (int mode = 0; mode < ArpegPatterns::numModes; ++mode) {
+        for (int numNotes = 0; numNotes <= NoteBuffer::maxCapacity; ++numNotes) {
+            const ArpegPatterns::Pattern& pattern = ArpegPatterns::get(mode, numNotes);
+            assertLE(pattern.size, ArpegPatterns::maxSteps);
+            const bool empty = (pattern.size == 0);
+            assertEQ(empty, (numNotes == 0));
+            for (int step = 0; step < pattern.size; ++step) {
+                assertLT(pattern.steps[step], numNotes);
+            }
+            for (int note = 0; note < numNotes; ++note) {
+                const int first = pattern.firstStep[note];
+                assertEQ(pattern.steps[first], note);
+                for (int step = 0; step < first; ++step) {
+                    assertNE(pattern.steps[step], note);
+                }
+            }
+        }
+    }
+}
+
+// changing mode keeps going from the note we were about to play
+static void testModeChangeKeepsPlace() {
+    NoteBuffer nb(8);
+    for (int i = 0; i < 5; ++i) {
+        nb.push_back(float(i), 0, i);
+    }
+    ArpegPlayer ap(&nb);
+    ap.setMode(ArpegPlayer::Mode::UP);
+    assertEQ(ap.clock().first, 0);
+    assertEQ(ap.clock().first, 1);
+
+    // about to play 2. Inside out plays 2 first
+    ap.setMode(ArpegPlayer::Mode::INSIDE_OUT);
+    assertEQ(ap.clock().first, 2);
+    assertEQ(ap.clock().first, 3);
+
+    // about to play 1. Down plays it fourth
+    ap.setMode(ArpegPlayer::Mode::DOWN);
+    assertEQ(ap.clock().first, 1);
+    assertEQ(ap.clock().first, 0);
+    assertEQ(ap.clock().first, 4);
+}
+
+void testArpegPatterns() {
+    testKnownPatterns();
+    testAllSizes();
+    testModeChangeKeepsPlace();
+}
@@ -0,0 +1,126 @@
+
+#include <memory>
+
+#include "ArpegPlayer.h"
+#include "ArpegProgram.h"
+#include "asserts.h"
+
+using ProgramPtr = std::unique_ptr<ArpegProgram>;
+
+static ProgramPtr compile(const char* text) {
+    std::string error;
+    ProgramPtr ret(ArpegProgram::compile(text, error));
+    assert(ret);
+    assert(error.empty());
+    return ret;
+}
+
+static void assertError(const char* text) {
+    std::string error;
+    ProgramPtr ret(ArpegProgram::compile(text, error));
+    assert(!ret);
+    assert(!error.empty());
+}
+
+static void assertSteps(const ArpegProgram& program, int numNotes, const int* steps, const int* octaves, int size) {
+    const ArpegPatterns::Pattern& pattern = program.get(numNotes);
+    assertEQ(pattern.size, size);
+    for (int i = 0; i < size; ++i) {
+        assertEQ(pattern.steps[i], steps[i]);
+        const int octave = octaves ? octaves[i] : 0;
+        assertEQ(pattern.octaves[i], octave);
+    }
+}
+
+static void testNotes() {
+    auto program = compile("1 3 2 4 +oct 1");
+    const int steps[] = {0, 2, 1, 3, 0};
+    const int octaves[] = {0, 0, 0, 0, 1};
+    assertSteps(*program, 4, steps, octaves, 5);
+    assertEQ(program->getText(), "1 3 2 4 +oct 1");
+
+    // not enough notes, so it wraps
+    const int steps3[] = {0, 2, 1, 0, 0};
+    assertSteps(*program, 3, steps3, octaves, 5);
+    assertEQ(program->get(0).size, 0);
+}
+
+static void testFromTop() {
+    auto program = compile("-1 -2 1");
+    const int steps[] = {4, 3, 0};
+    assertSteps(*program, 5, steps, nullptr, 3);
+}
+
+static void testModes() {
+    auto program = compile("Up down");
+    const int steps[] = {0, 1, 2, 2, 1, 0};
+    assertSteps(*program, 3, steps, nullptr, 6);
+}
+
+static void testRepeat() {
+    auto program = compile("(1 2) x3 -oct 3");
+    const int steps[] = {0, 1, 0, 1, 0, 1, 2};
+    const int octaves[] = {0, 0, 0, 0, 0, 0, -1};
+    assertSteps(*program, 3, steps, octaves, 7);
+}
+
+// repeats play the group again, octave changes and all
+static void testClimb() {
+    auto program = compile("(up +oct) x3");
+    const int steps[] = {0, 1, 0, 1, 0, 1};
+    const int octaves[] = {0, 0, 1, 1, 2, 2};
+    assertSteps(*program, 2, steps, octaves, 6);
+}
+
+static void testErrors() {
+    assertError("");
+    assertError("   ");
+    assertError("0");
+    assertError("1 fred");
+    assertError("(1 2");
+    assertError("1 2)");
+    assertError("x2");
+    assertError("1 x0");
+    assertError("1 x1000");
+    assertError("shuffle");
+    assertError("+oct +oct +oct +oct +oct 1");
+    assertError("(((up x64) x64) x64)");
+    assertError("((((+oct -oct) x64) x64) x64) 1");
+}
+
+static void testPlayer() {
+    NoteBuffer nb(8);
+    nb.push_back(2, 20, 0);
+    nb.push_back(1, 10, 1);
+    nb.push_back(3, 30, 2);
+    ArpegPlayer ap(&nb);
+    auto program = compile("3 1 +oct 2");
+    ap.setProgram(program.get());
+
+    const float expected[] = {3, 1, 3, 3, 1, 3};
+    for (float pitch : expected) {
+        const auto x = ap.clock();
+        assertEQ(x.first, pitch);
+    }
+
+    // octave moves cv1, not cv2
+    ap.setProgram(nullptr);
+    ap.setMode(ArpegPlayer::Mode::DOWN);
+    auto x = ap.clock();
+    assertEQ(x.first, 3);
+    ap.setProgram(program.get());
+    x = ap.clock();
+    x = ap.clock();
+    assertEQ(x.first, 3);
+    assertEQ(x.second, 20);
+}
+
+void testArpegProgram() {
+    testNotes();
+    testFromTop();
+    testModes();
+    testRepeat();
+    testClimb();
+    testErrors();
+    testPlayer();
+}
@@ -1,6 +1,8 @@
 
 #include "Chord4.h"
 #include "Chord4List.h"
+#include "Chord4Manager.h"
+#include "HarmonyChords.h"
 #include "HarmonyNote.h"
 #include "KeysigOld.h"
 #include "Options.h"
@@ -301,6 +303,259 @@ static void testMinMax() {
     testMinMax(true);
 }
 
+static void testSeventhChords() {
+    Options options = makeOptions(false);
+    options.style->setSeventhChords(true);
+
+    // G7 in C
+    Chord4List l(options, 5);
+    assert(l.isValid());
+    bool seenThird = false;
+    for (int i = 0; i < l.size(); ++i) {
+        const Chord4* c = l.get2(i);
+        const ScaleRelativeNote* srn = c->fetchSRNNotes();
+        int count[8] = {0};
+        for (int voice = 0; voice < 4; ++voice) {
+            switch (int(srn[voice])) {
+                case 5:
+                    count[1]++;
+                    break;
+                case 7:
+                    count[3]++;
+                    break;
+                case 2:
+                    count[5]++;
+                    break;
+                case 4:
+                    count[7]++;
+                    break;
+                default:
+                    assert(false);  // not in G7
+            }
+        }
+        // fifth may be left out
+        assertGT(count[1], 0);
+        assertGT(count[3], 0);
+        assertGT(count[7], 0);
+        if (c->isCorrectDoubling(options)) {
+            // never double the third or seventh
+            assertEQ(count[3], 1);
+            assertEQ(count[7], 1);
+        }
+        if (c->inversion(options) == THIRD_INVERSION) {
+            seenThird = true;
+            assertEQ(int(srn[0]), 4);
+        }
+    }
+    assert(seenThird);
+}
+
+// every scale the module offers should make chords on every root
+static void testAllScales(bool seventh) {
+    for (int mode = 0; mode <= int(Scale::Scales::WholeStep); ++mode) {
+        Options options = makeOptions(false);
+        options.keysig->set(MidiNote(MidiNote::C), Scale::Scales(mode));
+        options.style->setSeventhChords(seventh);
+        Chord4Manager mgr(options);
+        assert(mgr.isValid());
+
+        const int numRoots = options.keysig->numDegrees();
+        const Chord4* prev = HarmonyChords::findChord(false, options, mgr, 1);
+        assert(prev);
+        for (int root = 2; root <= numRoots; ++root) {
+            assertGT(mgr.size(root), 0);
+            const Chord4* next = HarmonyChords::findChord(false, options, mgr, *prev, root);
+            assert(next);
+            assertEQ(next->fetchRoot(), root);
+            prev = next;
+        }
+    }
+}
+
+static void testAllScales() {
+    testAllScales(false);
+    testAllScales(true);
+}
+
+static void testPitchNames() {
+    for (int pitch = 0; pitch < 128; ++pitch) {
+        char buffer[PitchKnowledge::maxNameLength + 1];
+        const int length = PitchKnowledge::formatAbs(pitch, buffer);
+        assertEQ(std::string(buffer), PitchKnowledge::nameOfAbs(pitch));
+
+        int parsed = -1;
+        assertEQ(PitchKnowledge::parseAbs(buffer, parsed), length);
+        assertEQ(parsed, pitch);
+    }
+
+    int pitch = 0;
+    int pitch2 = 0;
+    assertEQ(PitchKnowledge::parseAbs("Db3", pitch), 3);
+    assertEQ(PitchKnowledge::parseAbs("C#3", pitch2), 3);
+    assertEQ(pitch, pitch2);
+    assertEQ(PitchKnowledge::parseAbs("H3", pitch), 0);
+    assertEQ(PitchKnowledge::parseAbs("C", pitch), 0);
+    assertEQ(PitchKnowledge::parseAbs("", pitch), 0);
+}
+
+static void testParse() {
+    Chord4::Packed voicing = 0;
+    assert(Chord4::parse("E2A2C3A3", voicing));
+    assertEQ(Chord4::unpack(voicing, 0), 52);
+    assertEQ(Chord4::unpack(voicing, 1), 57);
+    assertEQ(Chord4::unpack(voicing, 2), 60);
+    assertEQ(Chord4::unpack(voicing, 3), 69);
+
+    assert(!Chord4::parse("E2A2C3", voicing));       // too short
+    assert(!Chord4::parse("E2A2C3A3C4", voicing));   // too long
+    assert(!Chord4::parse("E2A2C3A", voicing));      // no octave
+    assert(!Chord4::parse("E2A2xC3A3", voicing));    // junk
+}
+
+// every voicing in the lists must round trip through a string,
+// and fromString and the index must both find it.
+static void testFromStringAll(bool minor) {
+    Options options = makeOptions(minor);
+    Chord4Manager mgr(options);
+    for (int root = 1; root <= 7; ++root) {
+        for (int rank = 0; rank < mgr.size(root); ++rank) {
+            const Chord4* chord = mgr.get2(root, rank);
+            char buffer[Chord4::maxStringLength + 1];
+            chord->format(buffer);
+            assertEQ(std::string(buffer), chord->toStringShort());
+
+            Chord4Ptr chord2 = Chord4::fromString(options, root, buffer);
+            assert(chord2);
+            assert(*chord2 == *chord);
+            assertEQ(chord2->packed(), chord->packed());
+            for (int i = 0; i < 4; ++i) {
+                assertEQ(int(chord2->fetchSRNNotes()[i]), int(chord->fetchSRNNotes()[i]));
+            }
+
+            assertEQ(mgr.find(root, chord->packed()), rank);
+            assert(mgr.find(root, buffer) == chord);
+        }
+    }
+}
+
+static void testFromStringIllegal() {
+    Options options = makeOptions(false);
+    Chord4Manager mgr(options);
+
+    // E2A2C3A3 is fine on 6, but it's not a C chord
+    assert(Chord4::fromString(options, 6, "E2A2C3A3"));
+    assert(mgr.find(6, "E2A2C3A3"));
+    assert(!Chord4::fromString(options, 1, "E2A2C3A3"));
+    assert(!mgr.find(1, "E2A2C3A3"));
+
+    // voices out of order
+    assert(!Chord4::fromString(options, 1, "C3E2G2C3"));
+
+    // malformed
+    assert(!Chord4::fromString(options, 1, "C3E3G3"));
+    assert(!mgr.find(1, "C3E3G3"));
+}
+
+// every voicing must be in the soprano index exactly once, under its own soprano.
+static void testSopranoIndex(bool seventh) {
+    Options options = makeOptions(false);
+    options.style->setSeventhChords(seventh);
+    Chord4Manager mgr(options);
+
+    int total = 0;
+    for (int root = 1; root <= 7; ++root) {
+        total += mgr.size(root);
+    }
+
+    int indexed = 0;
+    for (int pitch = 0; pitch < 128; ++pitch) {
+        const Chord4Manager::VoicingRef* refs;
+        const int count = mgr.withSoprano(pitch, refs);
+        for (int i = 0; i < count; ++i) {
+            const Chord4* chord = mgr.get2(refs[i].root, refs[i].rank);
+            assert(chord);
+            assertEQ(int(chord->fetchNotes()[3]), pitch);
+            if (i > 0) {
+                const bool inOrder = (refs[i].rank > refs[i - 1].rank) ||
+                                     ((refs[i].rank == refs[i - 1].rank) && (refs[i].root > refs[i - 1].root));
+                assert(inOrder);
+            }
+        }
+        indexed += count;
+    }
+    assertEQ(indexed, total);
+
+    // out of range pitches fold into range by octaves
+    const int high = mgr.closestSoprano(127);
+    assertGE(high, 0);
+    assertEQ((127 - high) % 12, 0);
+    const int low = mgr.closestSoprano(0);
+    assertGE(low, 0);
+    assertEQ(low % 12, 0);
+    // C# isn't in C major, so it can't be a soprano
+    assertEQ(mgr.closestSoprano(61), -1);
+}
+
+// every voicing in the tables must be recognized, whatever order the pitches come in.
+static void testRecognizeAll(bool seventh) {
+    Options options = makeOptions(false);
+    options.style->setSeventhChords(seventh);
+    Chord4Manager mgr(options);
+    for (int root = 1; root <= 7; ++root) {
+        for (int rank = 0; rank < mgr.size(root); ++rank) {
+            const Chord4* chord = mgr.get2(root, rank);
+            const HarmonyNote* notes = chord->fetchNotes();
+            const int pitches[] = {notes[2], notes[0], notes[3], notes[1]};
+            auto r = mgr.recognize(pitches);
+            assertEQ(r.root, root);
+            assertEQ(r.rank, rank);
+            assertEQ(r.inversion, int(chord->inversion(options)));
+        }
+    }
+}
+
+// voicings that aren't in the tables fall back to the pitch classes.
+static void testRecognizeOther() {
+    Options options = makeOptions(false);
+    Chord4Manager mgr(options);
+
+    // C major, very low
+    const int low[] = {24, 28, 31, 36};
+    auto r = mgr.recognize(low);
+    assertEQ(r.root, 1);
+    assertEQ(r.rank, -1);
+    assertEQ(r.inversion, 0);
+    assertEQ(r.doubled, 1);
+
+    // first inversion, doubled fifth
+    const int first[] = {31, 28, 36, 43};
+    r = mgr.recognize(first);
+    assertEQ(r.root, 1);
+    assertEQ(r.inversion, 1);
+    assertEQ(r.doubled, 5);
+
+    // D minor in second inversion
+    const int second[] = {33, 38, 41, 45};
+    r = mgr.recognize(second);
+    assertEQ(r.root, 2);
+    assertEQ(r.inversion, 2);
+
+    // not a chord
+    const int cluster[] = {60, 62, 64, 65};
+    r = mgr.recognize(cluster);
+    assertEQ(r.root, 0);
+
+    // G7 with no fifth, only a chord when we are doing sevenths.
+    const int g7[] = {43, 47, 53, 55};
+    assertEQ(mgr.recognize(g7).root, 0);
+    options.style->setSeventhChords(true);
+    Chord4Manager mgr7(options);
+    r = mgr7.recognize(g7);
+    assertEQ(r.root, 5);
+    assertEQ(r.inversion, 0);
+    assertEQ(r.doubled, 1);
+}
+
 void testChord() {
     assert(__numChord4 == 0);
     test0();
@@ -317,6 +572,18 @@ void testChord() {
 
     testRanges();
     testMinMax();
+    testSeventhChords();
+    testAllScales();
+    testPitchNames();
+    testParse();
+    testFromStringAll(false);
+    testFromStringAll(true);
+    testFromStringIllegal();
+    testSopranoIndex(false);
+    testSopranoIndex(true);
+    testRecognizeAll(false);
+    testRecognizeAll(true);
+    testRecognizeOther();
 
     assert(__numChord4 == 0);
 }
\ No newline at end of file
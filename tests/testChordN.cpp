@@ -0,0 +1,101 @@
+#include "Chord4.h"
+#include "Chord4Manager.h"
+#include "HarmonyChords.h"
+#include "KeysigOld.h"
+#include "Options.h"
+#include "ProgressionAnalyzer.h"
+#include "Style.h"
+#include "asserts.h"
+
+static Options makeOptions() {
+    auto keysig = std::make_shared<KeysigOld>(Roots::C);
+    auto style = std::make_shared<Style>();
+    Options o(keysig, style);
+    return o;
+}
+
+// four voices must still use exactly the SATB ranges
+static void testStyleRanges4() {
+    Style style;
+    assertEQ(style.minPitch(0, 4), style.minBass());
+    assertEQ(style.maxPitch(0, 4), style.maxBass());
+    assertEQ(style.minPitch(1, 4), style.minTenor());
+    assertEQ(style.maxPitch(1, 4), style.maxTenor());
+    assertEQ(style.minPitch(2, 4), style.minAlto());
+    assertEQ(style.maxPitch(2, 4), style.maxAlto());
+    assertEQ(style.minPitch(3, 4), style.minSop());
+    assertEQ(style.maxPitch(3, 4), style.maxSop());
+}
+
+static void testStyleRangesN(int numVoices) {
+    Style style;
+    assertEQ(style.minPitch(0, numVoices), style.minBass());
+    assertEQ(style.maxPitch(numVoices - 1, numVoices), style.maxSop());
+    for (int i = 1; i < numVoices; ++i) {
+        assertGE(style.minPitch(i, numVoices), style.minPitch(i - 1, numVoices));
+        assertGE(style.maxPitch(i, numVoices), style.maxPitch(i - 1, numVoices));
+    }
+}
+
+template <int N>
+static void testManager() {
+    auto options = makeOptions();
+    ChordNManager<N> mgr(options);
+    assert(mgr.isValid());
+
+    for (int root = 1; root < 8; ++root) {
+        const int size = mgr.size(root);
+        assertGT(size, 0);
+        for (int rank = 0; rank < size; ++rank) {
+            const ChordN<N>* chord = mgr.get2(root, rank);
+            assert(chord);
+            assert(chord->isValid());
+            assertEQ(chord->fetchRoot(), root);
+            assert(chord->isAcceptableDoubling(options));
+
+            const HarmonyNote* notes = chord->fetchNotes();
+            for (int voice = 0; voice < N; ++voice) {
+                assertGE(int(notes[voice]), options.style->minPitch(voice, N));
+                assertLE(int(notes[voice]), options.style->maxPitch(voice, N));
+                if (voice > 0) {
+                    assertGT(int(notes[voice]), int(notes[voice - 1]));
+                }
+            }
+        }
+    }
+}
+
+template <int N>
+static void testProgression() {
+    auto options = makeOptions();
+    ChordNManager<N> mgr(options);
+
+    const ChordN<N>* a = HarmonyChordsN<N>::findChord(false, options, mgr, 1);
+    assert(a);
+    const ChordN<N>* b = HarmonyChordsN<N>::findChord(false, options, mgr, *a, 4);
+    assert(b);
+    const ChordN<N>* c = HarmonyChordsN<N>::findChord(false, options, mgr, *a, *b, 5);
+    assert(c);
+    const ChordN<N>* d = HarmonyChordsN<N>::findChord(false, options, mgr, *b, *c, 1);
+    assert(d);
+    assertEQ(d->fetchRoot(), 1);
+    assertLE(d->penaltForFollowingThisGuy(options, ProgressionAnalyzerN<N>::MAX_PENALTY, c, false),
+             ProgressionAnalyzerN<N>::AVG_PENALTY_PER_RULE);
+}
+
+template <int N>
+static void testN() {
+    testStyleRangesN(N);
+    testManager<N>();
+    testProgression<N>();
+}
+
+void testChordN() {
+    assertEQ(__numChord4, 0);
+    testStyleRanges4();
+    testN<3>();
+    testN<4>();
+    testN<5>();
+    testN<6>();
+    assertEQ(__numChord4, 0);
+}
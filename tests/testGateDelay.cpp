@@ -1,5 +1,8 @@
 
+#include <stdlib.h>
+
 #include "GateDelay.h"
+#include "SchmidtTrigger.h"
 #include "TestComposite.h"
 #include "asserts.h"
 
@@ -78,7 +81,145 @@ static void testWithDelay() {
      }
 }
 
+// the bank should do just what 16 SchmidtTriggers do
+static void testBankMatchesScalar() {
+    SchmidtTriggerBank bank;
+    SchmidtTrigger triggers[16];
+    float voltages[16] = {0};
+    for (int i = 0; i < 10000; ++i) {
+        for (int ch = 0; ch < 16; ++ch) {
+            voltages[ch] = 2.5f * float(rand()) / float(RAND_MAX);
+        }
+        const unsigned gates = bank.go(voltages, 16);
+        for (int ch = 0; ch < 16; ++ch) {
+            const bool expected = triggers[ch].go(voltages[ch]);
+            const bool actual = gates & (1u << ch);
+            assertEQ(actual, expected);
+        }
+    }
+}
+
+static void testBankChannels() {
+    SchmidtTriggerBank bank;
+    float voltages[16];
+    for (int ch = 0; ch < 16; ++ch) {
+        voltages[ch] = 10;
+    }
+    assertEQ(bank.go(voltages, 3), 7u);
+
+    // channels past the end keep what they had
+    for (int ch = 0; ch < 16; ++ch) {
+        voltages[ch] = 0;
+    }
+    assertEQ(bank.go(voltages, 1), 6u);
+    assertEQ(bank.get(), 6u);
+}
+
+/**
+ * Gate goes high at sample 10. CV goes from 0 to 1 at cvSample, or ramps
+ * if slew. Returns the sample the gate came out, and the cv then.
+ */
+static std::pair<int, float> runAdaptive(int cvSample, bool slew = false) {
+    GateDelay gd;
+    gd.setMode(GateDelay::Mode::ADAPTIVE);
+    Input gate;
+    Input cv;
+    for (int i = 0; i < 1000; ++i) {
+        gate.setVoltage((i >= 10) ? 10.f : 0.f, 0);
+        float v = (i >= cvSample) ? 1.f : 0.f;
+        if (slew) {
+            v = float(i) / 100.f;
+        }
+        cv.setVoltage(v, 0);
+        gd.process(gate, 1, &cv, 1);
+        if (gd.getGate(0)) {
+            return std::make_pair(i, v);
+        }
+    }
+    return std::make_pair(-1, 0.f);
+}
+
+static void testAdaptive() {
+    // cv with the gate: wait one sample to see it's still
+    auto x = runAdaptive(10);
+    assertEQ(x.first, 11);
+    assertEQ(x.second, 1);
+
+    // cv ahead of the gate: no wait
+    x = runAdaptive(8);
+    assertEQ(x.first, 10);
+    assertEQ(x.second, 1);
+
+    // cv late. Wait for it.
+    x = runAdaptive(13);
+    assertEQ(x.first, 14);
+    assertEQ(x.second, 1);
+
+    // cv didn't move. Give it quietSamples in case it's late.
+    x = runAdaptive(-100);
+    assertEQ(x.first, 10 + GateDelay::quietSamples);
+
+    // cv that never settles gets cut off
+    x = runAdaptive(0, true);
+    assertEQ(x.first, 10 + 88);
+}
+
+static void testAdaptiveSampleRate() {
+    GateDelay gd;
+    gd.setMode(GateDelay::Mode::ADAPTIVE);
+    gd.setSampleRate(96000);
+    Input gate;
+    Input cv;
+    gate.setVoltage(10, 0);
+    int i = 0;
+    for (; !gd.getGate(0); ++i) {
+        cv.setVoltage(float(i), 0);
+        gd.process(gate, 1, &cv, 1);
+    }
+    assertEQ(i, 193);  // 2 ms at 96k, plus one
+}
+
+// gate goes away before the cv settles: no note
+static void testAdaptiveShortGate() {
+    GateDelay gd;
+    gd.setMode(GateDelay::Mode::ADAPTIVE);
+    Input gate;
+    Input cv;
+    gate.setVoltage(10, 0);
+    cv.setVoltage(1, 0);
+    gd.process(gate, 1, &cv, 1);
+    assert(!gd.getGate(0));
+    gate.setVoltage(0, 0);
+    for (int i = 0; i < 10; ++i) {
+        gd.process(gate, 1, &cv, 1);
+        assert(!gd.getGate(0));
+    }
+}
+
+// one gate for all the cv: wait for the last one to settle
+static void testAdaptiveMonoGate() {
+    GateDelay gd;
+    gd.setMode(GateDelay::Mode::ADAPTIVE);
+    Input gate;
+    Input cv;
+    gate.setVoltage(10, 0);
+    cv.setVoltage(1, 0);
+    gd.process(gate, 1, &cv, 3);
+    assert(!gd.getGate(0));
+    cv.setVoltage(2, 2);
+    gd.process(gate, 1, &cv, 3);
+    assert(!gd.getGate(0));
+    gd.process(gate, 1, &cv, 3);
+    assert(gd.getGate(0));
+}
+
 void testGateDelay() {
+    testAdaptive();
+    testAdaptiveSampleRate();
+    testAdaptiveShortGate();
+    testAdaptiveMonoGate();
+    testBankMatchesScalar();
+    testBankChannels();
     testInit();
     testNoDelay();
     testWithDelay();
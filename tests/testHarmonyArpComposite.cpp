@@ -0,0 +1,144 @@
+#include "HarmonyArp.h"
+#include "TestComposite.h"
+#include "asserts.h"
+
+using Comp = HarmonyArp<TestComposite>;
+
+static void connect(Comp& h, int numChannels) {
+    h.inputs[Comp::CV_INPUT].channels = numChannels;
+    h.outputs[Comp::QUANTIZER_OUTPUT].channels = 1;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h.outputs[Comp::TENOR_OUTPUT].channels = 1;
+    h.outputs[Comp::ALTO_OUTPUT].channels = 1;
+    h.outputs[Comp::SOPRANO_OUTPUT].channels = 1;
+    h.inputs[Comp::CLOCK_INPUT].channels = 1;
+}
+
+static void assertNotesAreOutputs(Comp& h) {
+    const NoteBuffer& nb = h.getNoteBuffer();
+    assertEQ(nb.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        assertEQ(nb.at(i).channel, i);
+        assertEQ(nb.at(i).cv1, h.outputs[Comp::BASS_OUTPUT + i].getVoltage(0));
+    }
+}
+
+static void testChordGoesIn() {
+    Comp h;
+    connect(h, 1);
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);
+    h.process(TestComposite::ProcessArgs());
+    assertNotesAreOutputs(h);
+
+    // a new chord replaces the old one
+    h.inputs[Comp::CV_INPUT].setVoltage(7.f / 12.f, 0);
+    h.process(TestComposite::ProcessArgs());
+    assertNotesAreOutputs(h);
+}
+
+// with the cable, the gate delay held the arp back. Now the chord
+// plays on the same sample it is found.
+static void testNoLatency() {
+    Comp h;
+    connect(h, 1);
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);
+    h.inputs[Comp::CLOCK_INPUT].setVoltage(10, 0);
+    h.process(TestComposite::ProcessArgs());
+
+    assertEQ(h.outputs[Comp::ARP_GATE_OUTPUT].getVoltage(0), cGateOutHi);
+    assertEQ(h.outputs[Comp::ARP_CV_OUTPUT].getVoltage(0), h.outputs[Comp::BASS_OUTPUT].getVoltage(0));
+}
+
+static void testArpPlaysChord() {
+    Comp h;
+    connect(h, 1);
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);
+    h.process(TestComposite::ProcessArgs());
+
+    // mode is up, so we get the notes low to high
+    float last = -100;
+    for (int i = 0; i < 4; ++i) {
+        h.inputs[Comp::CLOCK_INPUT].setVoltage(10, 0);
+        h.process(TestComposite::ProcessArgs());
+        const float cv = h.outputs[Comp::ARP_CV_OUTPUT].getVoltage(0);
+        assertGT(cv, last);
+        last = cv;
+        h.inputs[Comp::CLOCK_INPUT].setVoltage(0, 0);
+        h.process(TestComposite::ProcessArgs());
+        assertEQ(h.outputs[Comp::ARP_GATE_OUTPUT].getVoltage(0), 0);
+    }
+    assertEQ(last, h.outputs[Comp::SOPRANO_OUTPUT].getVoltage(0));
+}
+
+static void testHold() {
+    Comp h;
+    connect(h, 1);
+    h.params[Comp::ARP_HOLD_PARAM].value = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);
+    h.process(TestComposite::ProcessArgs());
+    h.inputs[Comp::CV_INPUT].setVoltage(7.f / 12.f, 0);
+    h.process(TestComposite::ProcessArgs());
+    assertEQ(h.getNoteBuffer().size(), 8);
+
+    // letting go of hold leaves just the current chord
+    h.params[Comp::ARP_HOLD_PARAM].value = 0;
+    h.process(TestComposite::ProcessArgs());
+    assertNotesAreOutputs(h);
+}
+
+static void testPoly() {
+    Comp h;
+    connect(h, 2);
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);
+    h.inputs[Comp::CV_INPUT].setVoltage(7.f / 12.f, 1);
+    h.process(TestComposite::ProcessArgs());
+
+    const NoteBuffer& nb = h.getNoteBuffer();
+    assertEQ(nb.size(), 8);
+    for (int i = 0; i < 8; ++i) {
+        assertEQ(nb.at(i).channel, i);
+    }
+
+    // drop down to mono. The chord for the second harmonizer goes away.
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    for (int i = 0; i < 40; ++i) {
+        h.process(TestComposite::ProcessArgs());
+    }
+    assertNotesAreOutputs(h);
+}
+
+// 16 harmonizers need 64 notes, more than the default length, or any length.
+static void testPoly16(int length) {
+    Comp h;
+    connect(h, 16);
+    h.params[Comp::ARP_LENGTH_PARAM].value = float(length);
+    for (int c = 0; c < 16; ++c) {
+        h.inputs[Comp::CV_INPUT].setVoltage(float(c % 7) / 12.f, c);
+    }
+    h.process(TestComposite::ProcessArgs());
+
+    const NoteBuffer& nb = h.getNoteBuffer();
+    assertEQ(nb.size(), 64);
+    bool found[64] = {false};
+    for (int i = 0; i < nb.size(); ++i) {
+        const int channel = nb.at(i).channel;
+        assertGE(channel, 0);
+        assertLT(channel, 64);
+        assert(!found[channel]);
+        found[channel] = true;
+    }
+}
+
+static void testPoly16() {
+    testPoly16(0);
+    testPoly16(4);
+}
+
+void testHarmonyArpComposite() {
+    testChordGoesIn();
+    testNoLatency();
+    testArpPlaysChord();
+    testHold();
+    testPoly();
+    testPoly16();
+}
@@ -247,6 +247,206 @@ static void testXtoY() {
     }
 }
 
+// the best alternative must be the chord findChord picks, and the rest
+// must be the next best voicings, in order.
+static void testAlternatives(int k) {
+    auto options = makeOptions(false);
+    Chord4Manager mgr(options);
+    HarmonyChords::Alternatives alternatives(k);
+
+    for (int root = 1; root <= 7; ++root) {
+        auto first = HarmonyChords::findChord(false, options, mgr, root);
+        assertEQ(HarmonyChords::findAlternatives(false, options, mgr, nullptr, nullptr, root, alternatives), k);
+        assert(alternatives.get(0) == first);
+        for (int i = 0; i < k; ++i) {
+            assertEQ(alternatives.penalty(i), 0);
+        }
+    }
+
+    const Chord4* a = HarmonyChords::findChord(false, options, mgr, 1);
+    const Chord4* b = HarmonyChords::findChord(false, options, mgr, *a, 4);
+    for (int root = 1; root <= 7; ++root) {
+        if (root == b->fetchRoot()) {
+            continue;
+        }
+        auto best = HarmonyChords::findChord(false, options, mgr, *a, *b, root);
+        const int found = HarmonyChords::findAlternatives(false, options, mgr, a, b, root, alternatives);
+        assertGT(found, 0);
+        assertLE(found, k);
+        assert(alternatives.get(0) == best);
+
+        // exhaustive search to check against.
+        int numBetter = 0;
+        for (int i = 0; i < found; ++i) {
+            const Chord4* chord = alternatives.get(i);
+            const int penalty = HarmonyChords::progressionPenalty(options, ProgressionAnalyzer::MAX_PENALTY, a, b, chord, false);
+            assertEQ(penalty, alternatives.penalty(i));
+            if (i > 0) {
+                assertGE(alternatives.penalty(i), alternatives.penalty(i - 1));
+            }
+        }
+        for (int rank = 0; rank < mgr.size(root); ++rank) {
+            const int penalty = HarmonyChords::progressionPenalty(options, ProgressionAnalyzer::MAX_PENALTY, a, b, mgr.get2(root, rank), false);
+            if (penalty < alternatives.penalty(found - 1)) {
+                ++numBetter;
+            }
+        }
+        // nothing we dropped beats the worst one we kept.
+        assertLT(numBetter, found);
+    }
+}
+
+static void testAlternatives() {
+    testAlternatives(1);
+    testAlternatives(3);
+    testAlternatives(HarmonyChords::Alternatives::maxSize);
+}
+
+// a C major scale in the soprano. Every chord must put the melody on top.
+static void testMelody(bool minor) {
+    auto options = makeOptions(minor);
+    Chord4Manager mgr(options);
+    const int melody[] = {72, 74, 76, 77, 79, 77, 76, 74, 72};
+
+    const Chord4* prevPrev = nullptr;
+    const Chord4* prev = nullptr;
+    for (int note : melody) {
+        const int soprano = mgr.closestSoprano(note);
+        if (soprano < 0) {
+            continue;  // not in the minor scale
+        }
+        const Chord4* chord = HarmonyChords::findChordForMelody(false, options, mgr, prevPrev, prev, soprano);
+        assert(chord);
+        assertEQ(int(chord->fetchNotes()[3]), soprano);
+        if (prev) {
+            assertNE(chord->fetchRoot(), prev->fetchRoot());
+            assertLT(chord->penaltForFollowingThisGuy(options, ProgressionAnalyzer::MAX_PENALTY, prev, false), ProgressionAnalyzer::MAX_PENALTY);
+        } else {
+            assertEQ(int(chord->inversion(options)), int(ROOT_POS_INVERSION));
+        }
+        prevPrev = prev;
+        prev = chord;
+    }
+}
+
+static void testMelody() {
+    testMelody(false);
+    testMelody(true);
+}
+
+// C major to G major
+static void testPivot() {
+    auto optionsC = makeOptions(false);
+    Chord4Manager mgrC(optionsC);
+    auto keysigG = std::make_shared<KeysigOld>(Roots::C);
+    keysigG->set(MidiNote::G, Scale::Scales::Major);
+    Options optionsG(keysigG, makeStyle());
+    Chord4Manager mgrG(optionsG);
+
+    // the C chord is the 4 chord in G
+    const Chord4* one = HarmonyChords::findChord(false, optionsC, mgrC, 1);
+    const Chord4* four = HarmonyChords::remap(mgrG, *one);
+    assert(four);
+    assertEQ(four->fetchRoot(), 4);
+    assertEQ(HarmonyChords::voiceMotion(*one, *four), 0);
+
+    // F isn't in G major, so the 4 chord needs a pivot
+    const Chord4* fChord = HarmonyChords::findChord(false, optionsC, mgrC, 4);
+    assert(!HarmonyChords::remap(mgrG, *fChord));
+    const Chord4* pivot = HarmonyChords::findPivotChord(mgrG, mgrC, *fChord);
+    assert(pivot);
+    assert(HarmonyChords::remap(mgrC, *pivot));
+    for (int i = 0; i < 4; ++i) {
+        const int pc = pivot->fetchNotes()[i] % 12;
+        assertNE(pc, MidiNote::F);
+        assertNE(pc, MidiNote::F + 1);
+    }
+    // nothing is closer than one semitone per voice that has F
+    assertGT(HarmonyChords::voiceMotion(*fChord, *pivot), 0);
+}
+
+static void testVoiceMotion() {
+    auto options = makeOptions(false);
+    Chord4Manager mgr(options);
+    const Chord4* a = mgr.get2(1, 0);
+    for (int rank = 0; rank < mgr.size(5); ++rank) {
+        const Chord4* b = mgr.get2(5, rank);
+        int expected = 0;
+        for (int i = 0; i < 4; ++i) {
+            expected += std::abs(int(a->fetchNotes()[i]) - int(b->fetchNotes()[i]));
+        }
+        assertEQ(HarmonyChords::voiceMotion(*a, *b), expected);
+        assertEQ(HarmonyChords::voiceMotion(a->packed(), mgr.packedVoicings(5)[rank]), expected);
+    }
+}
+
+// the chord picked must have the best score of all of them.
+static void testSmooth(Style::VoiceLeading voiceLeading) {
+    auto options = makeOptions(false);
+    Chord4Manager mgr(options);
+    options.style->setVoiceLeading(voiceLeading);
+    const int motionPenalty = options.style->motionPenalty();
+    assertGT(motionPenalty, 0);
+
+    const int roots[] = {1, 4, 5, 1, 6, 2, 5, 3, 6, 4, 7, 1};
+    const Chord4* prevPrev = nullptr;
+    const Chord4* prev = HarmonyChords::findChord(false, options, mgr, roots[0]);
+    for (int i = 1; i < 12; ++i) {
+        const int root = roots[i];
+        const Chord4* chord = prevPrev ? HarmonyChords::findChord(false, options, mgr, *prevPrev, *prev, root) : HarmonyChords::findChord(false, options, mgr, *prev, root);
+        assert(chord);
+
+        int bestScore = std::numeric_limits<int>::max();
+        for (int rank = 0; rank < mgr.size(root); ++rank) {
+            const Chord4* candidate = mgr.get2(root, rank);
+            const int penalty = HarmonyChords::progressionPenalty(options, ProgressionAnalyzer::MAX_PENALTY, prevPrev, prev, candidate, false);
+            if (penalty < ProgressionAnalyzer::MAX_PENALTY) {
+                bestScore = std::min(bestScore, penalty + motionPenalty * HarmonyChords::voiceMotion(*prev, *candidate));
+            }
+        }
+        const int penalty = HarmonyChords::progressionPenalty(options, ProgressionAnalyzer::MAX_PENALTY, prevPrev, prev, chord, false);
+        assertEQ(penalty + motionPenalty * HarmonyChords::voiceMotion(*prev, *chord), bestScore);
+
+        prevPrev = prev;
+        prev = chord;
+    }
+}
+
+static int penaltyInScale(Scale::Scales scale, int rootA, const char* chordA, int rootB, const char* chordB) {
+    auto options = makeOptions(false);
+    options.keysig->set(MidiNote(MidiNote::C), scale);
+    auto a = Chord4::fromString(options, rootA, chordA);
+    auto b = Chord4::fromString(options, rootB, chordB);
+    assert(a);
+    assert(b);
+    return b->penaltForFollowingThisGuy(options, ProgressionAnalyzer::MAX_PENALTY, a.get(), false);
+}
+
+// C Eb F G Bb. Bb-F to C-G is a real parallel fifth, but only four scale degrees apart.
+// C-Bb to G-F is five degrees apart, but a seventh.
+static void testParallelPentatonic() {
+    const auto scale = Scale::Scales::MinorPentatonic;
+    int penalty = penaltyInScale(scale, 1, "C2A#2F3C4", 2, "C2C3G3D#4");
+    assertEQ(penalty, ProgressionAnalyzer::AVG_PENALTY_PER_RULE);
+    penalty = penaltyInScale(scale, 1, "C2A#2F3A#3", 2, "G2C3D#3G3");
+    assertEQ(penalty, 0);
+}
+
+// C D E F# G# A#. No fifths at all, but octaves are still octaves.
+static void testParallelWholeTone() {
+    const auto scale = Scale::Scales::WholeStep;
+    int penalty = penaltyInScale(scale, 1, "C2C3E3G#3", 2, "D2D3F#3A#3");
+    assertGE(penalty, ProgressionAnalyzer::AVG_PENALTY_PER_RULE);
+    penalty = penaltyInScale(scale, 1, "C2C3E3G#3", 2, "A#1D3F#3A#3");
+    assertEQ(penalty, 0);
+}
+
+static void testSmooth() {
+    testVoiceMotion();
+    testSmooth(Style::VoiceLeading::WEIGHTED);
+    testSmooth(Style::VoiceLeading::SMOOTHEST);
+}
+
 void testHarmonyChords() {
     testFirstChord();
     testBasic1();
@@ -265,6 +465,12 @@ void testHarmonyChords() {
     test2to1b();
 
     test1to2to1();
+    testAlternatives();
+    testMelody();
+    testPivot();
+    testSmooth();
+    testParallelPentatonic();
+    testParallelWholeTone();
     printf("--- test 3 ----\n");
     printf("put back 3 seq\n");
     // testThreeSequence();
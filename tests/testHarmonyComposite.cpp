@@ -1,5 +1,6 @@
 
 #include "Harmony.h"
+#include "HarmonyChords.h"
 #include "SqLog.h"
 #include "TestComposite.h"
 #include "asserts.h"
@@ -191,6 +192,323 @@ static void testNumChords() {
 
 }
 
+// sweep the input slowly up through five degrees, like a knob turn, then hold.
+static void sweep(Comp& h, int samplesPerDegree) {
+    const float degrees[] = {0, 2.f / 12.f, 4.f / 12.f, 5.f / 12.f, 7.f / 12.f};
+    for (float v : degrees) {
+        h.inputs[Comp::CV_INPUT].setVoltage(v, 0);
+        for (int i = 0; i < samplesPerDegree; ++i) {
+            h.process(TestComposite::ProcessArgs());
+        }
+    }
+    for (int i = 0; i < 2000; ++i) {
+        h.process(TestComposite::ProcessArgs());
+    }
+}
+
+static void testSettleTime() {
+    Comp h;
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    sweep(h, 100);
+    assertEQ(h.getSearchCount(), 5);
+    assertEQ(h.getSuppressedSearchCount(), 0);
+
+    Comp h2;
+    h2.inputs[Comp::CV_INPUT].channels = 1;
+    h2.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h2.params[Comp::SETTLE_TIME_PARAM].value = 10;  // 441 samples
+    sweep(h2, 100);
+    SQINFO("settle time: searches %d suppressed %d", h2.getSearchCount(), h2.getSuppressedSearchCount());
+    assertEQ(h2.getSearchCount(), 1);  // just the final settled root
+    assertEQ(h2.getSuppressedSearchCount(), 4);
+}
+
+// slewed input with a little noise on it
+static int slewSearches(float hysteresis) {
+    Comp h;
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h.params[Comp::HYSTERESIS_PARAM].value = hysteresis;
+    const int samples = 44100;
+    unsigned noise = 1;
+    for (int i = 0; i < samples; ++i) {
+        noise = noise * 1664525 + 1013904223;
+        const float n = ((noise >> 16) / 65536.f - .5f) * (.2f / 12.f);
+        const float v = float(i) / float(samples) + n;
+        h.inputs[Comp::CV_INPUT].setVoltage(v, 0);
+        h.process(TestComposite::ProcessArgs());
+    }
+    return h.getSearchCount();
+}
+
+static void testHysteresis() {
+    const int without = slewSearches(0);
+    const int with = slewSearches(.25f);
+    SQINFO("slewed input: %d searches without hysteresis, %d with", without, with);
+    assertGT(without, 2 * with);
+
+    // one octave of C major, one search per degree
+    assertGE(with, 7);
+    assertLE(with, 9);
+}
+
+// input doesn't change, but the key does. Must still re-quantize.
+static void testStaticInputKeyChange() {
+    Comp h;
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(2.f / 12.f, 0);  // D
+    for (int i = 0; i < 64; ++i) {
+        h.process(TestComposite::ProcessArgs());
+    }
+    const float before = h.outputs[Comp::QUANTIZER_OUTPUT].getVoltage(0);
+    assertClose(before, 2.f / 12.f, .0001);
+
+    h.params[Comp::KEY_PARAM].value = 1;  // C# major has no D
+    for (int i = 0; i < 64; ++i) {
+        h.process(TestComposite::ProcessArgs());
+    }
+    const float after = h.outputs[Comp::QUANTIZER_OUTPUT].getVoltage(0);
+    assertNE(after, before);
+}
+
+static void connectAll(Comp& h) {
+    h.outputs[Comp::QUANTIZER_OUTPUT].channels = 1;
+    h.outputs[Comp::BASS_OUTPUT].channels = 1;
+    h.outputs[Comp::TENOR_OUTPUT].channels = 1;
+    h.outputs[Comp::ALTO_OUTPUT].channels = 1;
+    h.outputs[Comp::SOPRANO_OUTPUT].channels = 1;
+}
+
+static void run(Comp& h, int samples) {
+    for (int i = 0; i < samples; ++i) {
+        h.process(TestComposite::ProcessArgs());
+    }
+}
+
+// each channel must give the same chords as a mono module with the same input
+static void testPoly4() {
+    const float roots[] = {0, 2.f / 12.f, 7.f / 12.f, 9.f / 12.f};
+    Comp poly;
+    connectAll(poly);
+    poly.inputs[Comp::CV_INPUT].channels = 4;
+    for (int c = 0; c < 4; ++c) {
+        poly.inputs[Comp::CV_INPUT].setVoltage(roots[c], c);
+    }
+    run(poly, 64);
+    assertEQ(poly.getNumChannels(), 4);
+    assertEQ(poly.outputs[Comp::QUANTIZER_OUTPUT].getChannels(), 4);
+    assertEQ(poly.outputs[Comp::BASS_OUTPUT].getChannels(), 4);
+    assertEQ(poly.outputs[Comp::SOPRANO_OUTPUT].getChannels(), 4);
+    assertEQ(poly.getSearchCount(), 4);
+
+    for (int c = 0; c < 4; ++c) {
+        Comp mono;
+        connectAll(mono);
+        mono.inputs[Comp::CV_INPUT].channels = 1;
+        mono.inputs[Comp::CV_INPUT].setVoltage(roots[c], 0);
+        run(mono, 64);
+        for (int port = Comp::QUANTIZER_OUTPUT; port <= Comp::SOPRANO_OUTPUT; ++port) {
+            assertEQ(poly.outputs[port].getVoltage(c), mono.outputs[port].getVoltage(0));
+        }
+    }
+
+    // only the channel that moves should search
+    poly.inputs[Comp::CV_INPUT].setVoltage(5.f / 12.f, 2);
+    run(poly, 64);
+    assertEQ(poly.getSearchCount(), 5);
+}
+
+// soprano only, so each harmonizer gets four channels
+static void testPolyPacked() {
+    Comp h;
+    h.outputs[Comp::SOPRANO_OUTPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].channels = 2;
+    h.inputs[Comp::CV_INPUT].setVoltage(2.f / 12.f, 0);
+    h.inputs[Comp::CV_INPUT].setVoltage(7.f / 12.f, 1);
+    run(h, 64);
+    assertEQ(h.outputs[Comp::SOPRANO_OUTPUT].getChannels(), 8);
+    for (int i = 0; i < 8; ++i) {
+        assertNE(h.outputs[Comp::SOPRANO_OUTPUT].getVoltage(i), 0);
+    }
+    // ascending within each harmonizer
+    for (int c = 0; c < 2; ++c) {
+        for (int i = 1; i < 4; ++i) {
+            assertGT(h.outputs[Comp::SOPRANO_OUTPUT].getVoltage(c * 4 + i), h.outputs[Comp::SOPRANO_OUTPUT].getVoltage(c * 4 + i - 1));
+        }
+    }
+}
+
+// in melody mode the soprano follows the input, in some octave.
+static void testMelodyMode() {
+    Comp h;
+    connectAll(h);
+    h.params[Comp::INPUT_MODE_PARAM].value = 1;
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    const float melody[] = {0, 2.f / 12.f, 4.f / 12.f, 7.f / 12.f, 5.f / 12.f, 0};
+    int searches = 0;
+    for (float pitch : melody) {
+        h.inputs[Comp::CV_INPUT].setVoltage(pitch, 0);
+        run(h, 64);
+        ++searches;
+        assertEQ(h.getSearchCount(), searches);
+        const float soprano = h.outputs[Comp::SOPRANO_OUTPUT].getVoltage(0);
+        const float octaves = soprano - h.outputs[Comp::QUANTIZER_OUTPUT].getVoltage(0);
+        assertClose(octaves, std::round(octaves), .0001);
+    }
+}
+
+// a chord on CHORD_INPUT becomes the chord the next search leads from.
+static void testChordInput() {
+    Comp h;
+    connectAll(h);
+    h.params[Comp::NNIC_PREFERENCE_PARAM].value = 1;  // match the default style
+    h.params[Comp::INVERSION_PREFERENCE_PARAM].value = int(Style::InversionPreference::DISCOURAGE_CONSECUTIVE);
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(7.f / 12.f, 0);  // 5
+    run(h, 64);
+
+    // not the voicing Harmony would pick for the 5
+    Options options(std::make_shared<KeysigOld>(Roots::C), std::make_shared<Style>());
+    Chord4Manager mgr(options);
+    const Chord4* played = mgr.get2(5, 7);
+    h.inputs[Comp::CHORD_INPUT].channels = 4;
+    for (int i = 0; i < 4; ++i) {
+        FloatNote fn;
+        NoteConvert::m2f(fn, MidiNote(12 + played->fetchNotes()[i]));
+        h.inputs[Comp::CHORD_INPUT].setVoltage(fn.get(), 3 - i);  // order doesn't matter
+    }
+    run(h, 64);
+    assertEQ(h.getRecognizedChord().root, 5);
+    assertEQ(h.getRecognizedChord().rank, 7);
+
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);  // 1
+    run(h, 64);
+    const Chord4* expected = HarmonyChords::findChord(false, options, mgr, *played, 1);
+    for (int i = 0; i < 4; ++i) {
+        FloatNote fn;
+        NoteConvert::m2f(fn, MidiNote(12 + expected->fetchNotes()[i]));
+        assertEQ(h.outputs[Comp::BASS_OUTPUT + i].getVoltage(0), fn.get());
+    }
+}
+
+// In C with the narrow range, every voicing with E on top is a 6 chord.
+// Following a 6 chord the melody has to re-voice it, and root mode
+// must still be able to lead from whatever history that leaves.
+static void testMelodySameRoot() {
+    const auto range = Style::Ranges::NARROW_RANGE;
+    Options options(std::make_shared<KeysigOld>(Roots::C), std::make_shared<Style>());
+    options.style->setRangesPreference(range);
+    Chord4Manager mgr(options);
+    const int soprano = mgr.closestSoprano(MidiNote::MiddleC + 4 - 12);
+    const Chord4Manager::VoicingRef* refs;
+    const int size = mgr.withSoprano(soprano, refs);
+    assertGT(size, 0);
+    for (int i = 0; i < size; ++i) {
+        assertEQ(refs[i].root, 6);
+    }
+
+    Comp h;
+    connectAll(h);
+    h.params[Comp::CENTER_PREFERENCE_PARAM].value = float(int(range));
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(9.f / 12.f, 0);  // 6
+    run(h, 64);
+    assertEQ(h.getSearchCount(), 1);
+
+    h.params[Comp::INPUT_MODE_PARAM].value = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(4.f / 12.f, 0);  // E
+    run(h, 64);
+    assertEQ(h.getSearchCount(), 2);
+
+    h.params[Comp::INPUT_MODE_PARAM].value = 0;
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);  // 1
+    run(h, 64);
+    assertEQ(h.getSearchCount(), 3);
+    h.inputs[Comp::CV_INPUT].setVoltage(7.f / 12.f, 0);  // 5
+    run(h, 64);
+    assertEQ(h.getSearchCount(), 4);
+}
+
+static void setKey(Comp& h, int key) {
+    h.params[Comp::KEY_PARAM].value = float(key);
+    run(h, 64);
+}
+
+// C major, play the 2 chord (D F A), then go to G major.
+// D is in both keys, so the input doesn't make a new chord, but D minor isn't in G.
+static void testKeyChange(bool pivot) {
+    Comp h;
+    connectAll(h);
+    h.params[Comp::PIVOT_PARAM].value = pivot ? 1 : 0;
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(2.f / 12.f, 0);
+    run(h, 64);
+    float before[4];
+    for (int i = 0; i < 4; ++i) {
+        before[i] = h.outputs[Comp::BASS_OUTPUT + i].getVoltage(0);
+    }
+    const int searches = h.getSearchCount();
+
+    setKey(h, MidiNote::G);
+    assertEQ(h.getSearchCount(), searches);
+    bool changed = false;
+    for (int i = 0; i < 4; ++i) {
+        const float v = h.outputs[Comp::BASS_OUTPUT + i].getVoltage(0);
+        changed |= (v != before[i]);
+        // no F in the pivot chord
+        MidiNote mn;
+        NoteConvert::f2m(mn, FloatNote(v));
+        assert(!pivot || (mn.get() % 12 != MidiNote::F));
+    }
+    assertEQ(changed, pivot);
+
+    // and we can go back and forth, and keep making chords
+    setKey(h, MidiNote::C);
+    setKey(h, MidiNote::G);
+    h.inputs[Comp::CV_INPUT].setVoltage(4.f / 12.f, 0);
+    run(h, 64);
+    assertEQ(h.getSearchCount(), searches + 1);
+}
+
+// the C chord is still legal in G, so the next chord is voice led from it.
+static void testKeyChangeContinuity() {
+    Comp h;
+    connectAll(h);
+    h.params[Comp::NNIC_PREFERENCE_PARAM].value = 1;  // match the default style
+    h.params[Comp::INVERSION_PREFERENCE_PARAM].value = int(Style::InversionPreference::DISCOURAGE_CONSECUTIVE);
+    h.inputs[Comp::CV_INPUT].channels = 1;
+    h.inputs[Comp::CV_INPUT].setVoltage(0, 0);
+    run(h, 64);
+    setKey(h, MidiNote::G);
+
+    h.inputs[Comp::CV_INPUT].setVoltage(2.f / 12.f, 0);  // D, the 5 in G
+    run(h, 64);
+
+    Options optionsC(std::make_shared<KeysigOld>(Roots::C), std::make_shared<Style>());
+    Chord4Manager mgrC(optionsC);
+    auto keysigG = std::make_shared<KeysigOld>(Roots::C);
+    keysigG->set(MidiNote::G, Scale::Scales::Major);
+    Options optionsG(keysigG, std::make_shared<Style>());
+    Chord4Manager mgrG(optionsG);
+
+    const Chord4* one = HarmonyChords::findChord(false, optionsC, mgrC, 1);
+    const Chord4* four = HarmonyChords::remap(mgrG, *one);
+    const Chord4* expected = HarmonyChords::findChord(false, optionsG, mgrG, *four, 5);
+    for (int i = 0; i < 4; ++i) {
+        FloatNote fn;
+        NoteConvert::m2f(fn, MidiNote(12 + expected->fetchNotes()[i]));
+        assertEQ(h.outputs[Comp::BASS_OUTPUT + i].getVoltage(0), fn.get());
+    }
+}
+
+static void testKeyChange() {
+    testKeyChange(false);
+    testKeyChange(true);
+    testKeyChangeContinuity();
+}
+
 void testHarmonyComposite() {
     test0();
     testQuant1();
@@ -203,4 +521,13 @@ void testHarmonyComposite() {
     testBassAndSopranoVoiceCount();
     test2and2VoiceCount();
     testNumChords();
+    testSettleTime();
+    testHysteresis();
+    testStaticInputKeyChange();
+    testPoly4();
+    testPolyPacked();
+    testMelodyMode();
+    testMelodySameRoot();
+    testChordInput();
+    testKeyChange();
 }
\ No newline at end of file
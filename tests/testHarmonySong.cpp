@@ -1,7 +1,12 @@
 #include "HarmonySong.h"
 #include "KeysigOld.h"
 #include "Options.h"
+#include "ProgressionAnalyzer.h"
 #include "Style.h"
+#include "asserts.h"
+
+#include <algorithm>
+#include <set>
 
 
 static StylePtr makeStyle() {
@@ -48,7 +53,114 @@ static void testGenerate() {
     testGenerate(true);
 }
 
+static int songPenalty(const Options& o, HarmonySong& s) {
+    int penalty = 0;
+    for (int i = 1; i < s.size(); ++i) {
+        penalty += s.get(i)->penaltyForFollowingThisGuy(o, ProgressionAnalyzer::MAX_PENALTY, *s.get(i - 1), false);
+    }
+    return penalty;
+}
+
+// compare with trying every song
+static void testGenerateBest(bool minor) {
+    auto o = makeOptions(minor);
+    int progression[] = {1, 4, 5, 0};
+    HarmonySong s(o, progression);
+    const int n = 50;
+    size_t bytes = 0;
+    auto songs = s.generateBest(o, n, bytes);
+    assertEQ(int(songs.size()), n);
+    assertGT(bytes, 0);
+
+    std::set<std::vector<int>> distinct;
+    for (int i = 0; i < n; ++i) {
+        if (i > 0) {
+            assertGE(songs[i].penalty, songs[i - 1].penalty);
+        }
+        distinct.insert(songs[i].ranks);
+        s.use(songs[i]);
+        assertEQ(songPenalty(o, s), songs[i].penalty);
+    }
+    assertEQ(int(distinct.size()), n);
+
+    Chord4Manager mgr(o);
+    const int size1 = mgr.size(1);
+    const int size4 = mgr.size(4);
+    const int size5 = mgr.size(5);
+    std::vector<int> a(size1 * size4);
+    for (int i = 0; i < size1; ++i) {
+        for (int j = 0; j < size4; ++j) {
+            a[i * size4 + j] = mgr.get2(4, j)->penaltForFollowingThisGuy(o, ProgressionAnalyzer::MAX_PENALTY, mgr.get2(1, i), false);
+        }
+    }
+    std::vector<int> b(size4 * size5);
+    for (int j = 0; j < size4; ++j) {
+        for (int k = 0; k < size5; ++k) {
+            b[j * size5 + k] = mgr.get2(5, k)->penaltForFollowingThisGuy(o, ProgressionAnalyzer::MAX_PENALTY, mgr.get2(4, j), false);
+        }
+    }
+    std::vector<int> all;
+    for (int i = 0; i < size1; ++i) {
+        for (int j = 0; j < size4; ++j) {
+            if (a[i * size4 + j] >= ProgressionAnalyzer::MAX_PENALTY) {
+                continue;
+            }
+            for (int k = 0; k < size5; ++k) {
+                if (b[j * size5 + k] < ProgressionAnalyzer::MAX_PENALTY) {
+                    all.push_back(a[i * size4 + j] + b[j * size5 + k]);
+                }
+            }
+        }
+    }
+    std::partial_sort(all.begin(), all.begin() + n, all.end());
+    for (int i = 0; i < n; ++i) {
+        assertEQ(songs[i].penalty, all[i]);
+    }
+}
+
+static void testGenerateBest() {
+    testGenerateBest(false);
+    testGenerateBest(true);
+}
+
+// a long song, edited one root at a time, must come out the same as searching from scratch.
+static void testEditRoot(bool minor) {
+    auto o = makeOptions(minor);
+    const int numChords = 100;
+    const int pattern[] = {1, 4, 5, 1, 6, 2, 5, 3};
+    int progression[numChords + 1];
+    for (int i = 0; i < numChords; ++i) {
+        progression[i] = pattern[i % 8];
+    }
+    progression[numChords] = 0;
+
+    HarmonySong s(o, progression);
+    const int penalty = s.generateOptimal(o);
+    assertEQ(penalty, songPenalty(o, s));
+    size_t bytes;
+    assertEQ(penalty, s.generateBest(o, 1, bytes)[0].penalty);
+
+    const int edits[][2] = {{50, 2}, {51, 6}, {10, 7}, {99, 4}, {0, 3}, {50, 1}};
+    for (auto e : edits) {
+        progression[e[0]] = e[1];
+        const int editedPenalty = s.editRoot(o, e[0], e[1]);
+        assertLT(s._stepsSearched(), numChords / 4);
+        assertEQ(editedPenalty, songPenalty(o, s));
+        assertEQ(s.get(e[0])->getRoot(), e[1]);
+
+        HarmonySong fresh(o, progression);
+        assertEQ(editedPenalty, fresh.generateOptimal(o));
+    }
+}
+
+static void testEditRoot() {
+    testEditRoot(false);
+    testEditRoot(true);
+}
+
 void  testHarmonySong() {
     test0();
     testGenerate();
+    testGenerateBest();
+    testEditRoot();
 }
\ No newline at end of file
@@ -129,6 +129,110 @@ static void testGetSet() {
     assert(x.second == Scale::Scales::Dorian);
 }
 
+// the table driven ScaleDeg must agree with the scale
+static void testScaleDegAllScales() {
+    KeysigOldPtr ks = std::make_shared<KeysigOld>(Roots::C);
+    StylePtr style = std::make_shared<Style>();
+    Options op(ks, style);
+    HarmonyNote hn(op);
+    for (int mode = 0; mode <= int(Scale::Scales::Chromatic); ++mode) {
+        for (int base = 0; base < 12; ++base) {
+            ks->set(MidiNote(base), Scale::Scales(mode));
+            auto scale = ks->getUnderlyingScale();
+            for (int pitch = 36; pitch < 36 + 24; ++pitch) {
+                const ScaleNote sn = scale->m2s(MidiNote(pitch));
+                const int expected = sn.isAccidental() ? 0 : sn.getDegree() + 1;
+                hn.setPitchDirectly(pitch);
+                assertEQ(int(ks->ScaleDeg(hn)), expected);
+            }
+        }
+    }
+}
+
+static void testChordTablesCMajor() {
+    KeysigOld ks(Roots::C);
+    assertEQ(ks.numDegrees(), 7);
+
+    // C E G
+    auto pcs = ks.chordPitchClasses(1, false);
+    assertEQ(pcs.size(), 3);
+    assert(pcs.contains(0));
+    assert(pcs.contains(4));
+    assert(pcs.contains(7));
+    assert(!pcs.contains(11));
+    assertEQ(ks.chordRole(1, false, 0), 1);
+    assertEQ(ks.chordRole(1, false, 4), 3);
+    assertEQ(ks.chordRole(1, false, 7), 5);
+    assertEQ(ks.chordRole(1, false, 11), 0);
+
+    // G B D F
+    pcs = ks.chordPitchClasses(5, true);
+    assertEQ(pcs.size(), 4);
+    assertEQ(ks.chordRole(5, true, 7), 1);
+    assertEQ(ks.chordRole(5, true, 11), 3);
+    assertEQ(ks.chordRole(5, true, 2), 5);
+    assertEQ(ks.chordRole(5, true, 5), 7);
+
+    // fifth is optional in seventh chords
+    assertEQ(ks.requiredChordRoles(5, false), ((1 << 1) | (1 << 3) | (1 << 5)));
+    assertEQ(ks.requiredChordRoles(5, true), ((1 << 1) | (1 << 3) | (1 << 7)));
+}
+
+static void testChordTablesOtherScales() {
+    KeysigOld ks(Roots::C);
+
+    // C Eb F G Bb. stacked "thirds" on C are C F Bb
+    ks.set(MidiNote(MidiNote::C), Scale::Scales::MinorPentatonic);
+    assertEQ(ks.numDegrees(), 5);
+    assertEQ(ks.chordRole(1, false, 0), 1);
+    assertEQ(ks.chordRole(1, false, 5), 3);
+    assertEQ(ks.chordRole(1, false, 10), 5);
+    assertEQ(ks.chordRole(1, false, 3), 0);
+
+    // diminished has 8 degrees, and every chord is a diminished seventh
+    ks.set(MidiNote(MidiNote::C), Scale::Scales::Diminished);
+    assertEQ(ks.numDegrees(), 8);
+    for (int root = 1; root <= 8; ++root) {
+        assertEQ(ks.chordPitchClasses(root, true).size(), 4);
+    }
+
+    // in whole tone the seventh wraps around to the root, so it's not required
+    ks.set(MidiNote(MidiNote::C), Scale::Scales::WholeStep);
+    assertEQ(ks.numDegrees(), 6);
+    assertEQ(ks.chordPitchClasses(1, true).size(), 3);
+    assertEQ(ks.requiredChordRoles(1, true), ((1 << 1) | (1 << 3)));
+}
+
+static void testLeadingTone() {
+    KeysigOld ks(Roots::C);
+    assertEQ(ks.leadingTone(), 7);
+    assertEQ(ks.dominant(), 5);
+
+    // the diatonic modes all use the traditional degrees
+    ks.set(MidiNote(MidiNote::C), Scale::Scales::Minor);
+    assertEQ(ks.leadingTone(), 7);
+    assertEQ(ks.dominant(), 5);
+
+    // C Eb F G Bb
+    ks.set(MidiNote(MidiNote::C), Scale::Scales::MinorPentatonic);
+    assertEQ(ks.leadingTone(), 0);
+    assertEQ(ks.dominant(), 4);
+
+    // no B, no G
+    ks.set(MidiNote(MidiNote::C), Scale::Scales::WholeStep);
+    assertEQ(ks.leadingTone(), 0);
+    assertEQ(ks.dominant(), 0);
+
+    // C D Eb F Gb Ab A B
+    ks.set(MidiNote(MidiNote::C), Scale::Scales::Diminished);
+    assertEQ(ks.leadingTone(), 8);
+    assertEQ(ks.dominant(), 0);
+
+    // G A Bb C Db Eb E F#
+    ks.set(MidiNote(MidiNote::G), Scale::Scales::Diminished);
+    assertEQ(ks.leadingTone(), 8);
+}
+
 void testKeysig() {
     testCinC();
     testAllInC();
@@ -136,4 +240,8 @@ void testKeysig() {
    // testStyle2();
     validateRanges();
     testGetSet();
+    testScaleDegAllScales();
+    testChordTablesCMajor();
+    testChordTablesOtherScales();
+    testLeadingTone();
 }
\ No newline at end of file
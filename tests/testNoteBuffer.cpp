@@ -1,4 +1,9 @@
 
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
 #include "NoteBuffer.h"
 #include "asserts.h"
 
@@ -290,6 +295,183 @@ static void testNoteBufferFindMedian() {
 }
 #endif
 
+static void testNoteBufferReplaceChannels() {
+    NoteBuffer nb(10);
+    int callbacks = 0;
+    nb.onChange([&callbacks](const NoteBuffer*) {
+        ++callbacks;
+    });
+    nb.push_back(1, 0, 0);
+    nb.push_back(2, 0, 5);
+    nb.push_back(3, 0, 1);
+    callbacks = 0;
+
+    // replace channels 0..3, channel 5 stays
+    const NoteBuffer::Data notes[] = {{10, 0, 0}, {11, 0, 1}, {12, 0, 2}};
+    nb.replaceChannels(0, 4, notes, 3);
+    assertEQ(callbacks, 1);
+    assertEQ(nb.size(), 4);
+    consistent(nb);
+    assertEQ(nb.at(0).cv1, 2);
+    assertEQ(nb.at(1).cv1, 10);
+    assertEQ(nb.at(3).cv1, 12);
+}
+
+static void testNoteBufferReplaceChannelsOverflow() {
+    NoteBuffer nb(3);
+    nb.push_back(1, 0, 8);
+    nb.push_back(2, 0, 9);
+    const NoteBuffer::Data notes[] = {{10, 0, 0}, {11, 0, 1}, {12, 0, 2}, {13, 0, 3}};
+
+    // like push_back, the oldest notes fall off
+    nb.replaceChannels(0, 4, notes, 4);
+    assertEQ(nb.size(), 3);
+    assertEQ(nb.at(0).cv1, 11);
+    assertEQ(nb.at(2).cv1, 13);
+}
+
+static void testNoteBufferReplaceChannelsHold() {
+    NoteBuffer nb(10);
+    nb.setHold(true);
+    const NoteBuffer::Data notes[] = {{10, 0, 0}, {11, 0, 1}};
+    nb.replaceChannels(0, 4, notes, 2);
+    nb.replaceChannels(0, 4, notes, 2);
+    assertEQ(nb.size(), 4);
+}
+
+static void testNoteBufferUpdate() {
+    NoteBuffer nb(10);
+    int callbacks = 0;
+    nb.onChange([&callbacks](const NoteBuffer*) {
+        ++callbacks;
+    });
+    nb.push_back(1, 0, 3);
+    nb.push_back(2, 0, 7);
+    nb.push_back(3, 0, 9);
+    callbacks = 0;
+
+    // 7 goes off, 3 gets a new note, 5 is new. Channel 12 has nothing to remove.
+    const int remove[] = {3, 7, 12};
+    const NoteBuffer::Data notes[] = {{10, 0, 3}, {11, 0, 5}};
+    nb.update(remove, 3, notes, 2);
+    assertEQ(callbacks, 1);
+    assertEQ(nb.size(), 3);
+    consistent(nb);
+    assertEQ(nb.at(0).cv1, 3);
+    assertEQ(nb.at(1).cv1, 10);
+    assertEQ(nb.at(2).cv1, 11);
+
+    // in hold, nothing goes
+    nb.setHold(true);
+    nb.update(remove, 3, notes, 2);
+    assertEQ(nb.size(), 5);
+}
+
+static void testNoteBufferBig() {
+    NoteBuffer nb(NoteBuffer::maxCapacity);
+    assertGE(NoteBuffer::maxCapacity, 128);
+    for (int i = 0; i < 200; ++i) {
+        nb.push_back(float(i), 0, i % 16);
+    }
+    assertEQ(nb.size(), NoteBuffer::maxCapacity);
+    consistent(nb);
+
+    // oldest ones fell off
+    const int first = 200 - NoteBuffer::maxCapacity;
+    int expected = first;
+    for (auto note : nb) {
+        assertEQ(note.cv1, float(expected));
+        ++expected;
+    }
+
+    // remove for channel takes the oldest one on that channel
+    nb.removeForChannel(first % 16);
+    assertEQ(nb.begin()->cv1, float(first + 1));
+    assertEQ(nb.size(), NoteBuffer::maxCapacity - 1);
+}
+
+// channels outside the indexed range still work, they are just slower to find
+static void testNoteBufferOddChannels() {
+    NoteBuffer nb(10);
+    nb.push_back(1, 0, 1000);
+    nb.push_back(2, 0, -5);
+    nb.push_back(3, 0, 1000);
+    nb.removeForChannel(1000);
+    assertEQ(nb.size(), 2);
+    assertEQ(nb.at(0).cv1, 2);
+    assertEQ(nb.at(1).cv1, 3);
+    nb.removeForChannel(-5);
+    nb.removeForChannel(1000);
+    assert(nb.empty());
+    consistent(nb);
+
+    // and all the slots came back
+    for (int i = 0; i < 10; ++i) {
+        nb.push_back(float(i), 0, i);
+    }
+    assertEQ(nb.size(), 10);
+}
+
+static void testNoteBufferChangeCount() {
+    NoteBuffer nb(4);
+    const unsigned x = nb.getChangeCount();
+    nb.push_back(1, 1, 0);
+    assertEQ(nb.getChangeCount(), x + 1);
+    nb.removeForChannel(7);
+    assertEQ(nb.getChangeCount(), x + 1);
+    nb.removeForChannel(0);
+    assertEQ(nb.getChangeCount(), x + 2);
+}
+
+static void assertSorted(const NoteBuffer& nb) {
+    for (int i = 1; i < nb.size(); ++i) {
+        assertLE(nb.getSorted(i - 1).cv1, nb.getSorted(i).cv1);
+    }
+}
+
+static void testNoteBufferSorted() {
+    NoteBuffer nb(5);
+    nb.push_back(3, 0, 0);
+    nb.push_back(1, 0, 1);
+    nb.push_back(2, 0, 2);
+    assertEQ(nb.getSorted(0).cv1, 1);
+    assertEQ(nb.getSorted(1).cv1, 2);
+    assertEQ(nb.getSorted(2).cv1, 3);
+
+    nb.removeForChannel(2);
+    assertEQ(nb.size(), 2);
+    assertEQ(nb.getSorted(0).cv1, 1);
+    assertEQ(nb.getSorted(1).cv1, 3);
+}
+
+// lots of random changes, with duplicate pitches. Compare to sorting.
+static void testNoteBufferSortedRandom() {
+    NoteBuffer nb(40);
+    for (int i = 0; i < 5000; ++i) {
+        const int channel = rand() % 50;
+        if (rand() % 3) {
+            nb.push_back(float(rand() % 20), float(rand() % 3), channel);
+        } else {
+            nb.removeForChannel(channel);
+        }
+        if ((i % 1000) == 999) {
+            nb.setCapacity(10 + rand() % 30);
+        }
+
+        std::vector<std::pair<float, float>> expected;
+        for (auto note : nb) {
+            expected.push_back(std::make_pair(note.cv1, note.cv2));
+        }
+        std::sort(expected.begin(), expected.end());
+        assertEQ(int(expected.size()), nb.size());
+        for (int j = 0; j < nb.size(); ++j) {
+            assertEQ(nb.getSorted(j).cv1, expected[j].first);
+            assertEQ(nb.getSorted(j).cv2, expected[j].second);
+        }
+    }
+    assertSorted(nb);
+}
+
 void testNoteBuffer() {
     testNoteBuffer0();
     testNoteBufferSize();
@@ -313,6 +495,15 @@ void testNoteBuffer() {
     testNoteBufferAddPast();
     testNoteBufferReduce();
     testNoteBufferHoldCB();
+    testNoteBufferReplaceChannels();
+    testNoteBufferReplaceChannelsOverflow();
+    testNoteBufferReplaceChannelsHold();
+    testNoteBufferUpdate();
+    testNoteBufferBig();
+    testNoteBufferOddChannels();
+    testNoteBufferChangeCount();
+    testNoteBufferSorted();
+    testNoteBufferSortedRandom();
 
     //  testNoteBufferFindMedian();
 }
\ No newline at end of file
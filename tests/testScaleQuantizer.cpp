@@ -59,6 +59,72 @@ static void testUpAndDownStep() {
     assert(false);
 }
 
+static ScaleQuantizerPtr makeWithHysteresis(float hysteresis) {
+    auto scale = std::make_shared<Scale>();
+    scale->set(MidiNote::C, Scale::Scales::Major);
+    auto options = std::make_shared<ScaleQuantizer::Options>();
+    options->scale = scale;
+    options->hysteresis = hysteresis;
+    return std::make_shared<ScaleQuantizer>(options);
+}
+
+// find the first voltage above start where plain quantizer changes its output
+static float findBoundary(float start) {
+    auto quantizer = ScaleQuantizer::makeTestCMaj();
+    const int first = quantizer->run(start).get();
+    for (float x = start; x < start + 1; x += .0001f) {
+        if (quantizer->run(x).get() != first) {
+            return x;
+        }
+    }
+    assert(false);
+    return 0;
+}
+
+static void testHysteresisJitter() {
+    const float hysteresis = .25f;  // semitones
+    const float boundary = findBoundary(0);
+    const float jitter = .1f / 12.f;  // less than the hysteresis
+
+    auto quantizer = makeWithHysteresis(hysteresis);
+    const int first = quantizer->run(0).get();
+    const int second = quantizer->run(boundary + jitter).get();
+    assertEQ(second, first);  // inside the band, so stuck
+
+    for (int i = 0; i < 10; ++i) {
+        assertEQ(quantizer->run(boundary - jitter).get(), first);
+        assertEQ(quantizer->run(boundary + jitter).get(), first);
+    }
+
+    // now go past the band
+    const float past = boundary + (hysteresis + .05f) / 12.f;
+    const int third = quantizer->run(past).get();
+    assertGT(third, first);
+
+    // coming back down into the band doesn't change it
+    assertEQ(quantizer->run(boundary - jitter).get(), third);
+    assertEQ(quantizer->run(0).get(), first);
+}
+
+// no hysteresis must be the same as the old quantizer
+static void testHysteresisZero() {
+    auto quantizer = makeWithHysteresis(0);
+    auto plain = ScaleQuantizer::makeTestCMaj();
+    for (float x = -2; x < 2; x += .003f) {
+        assertEQ(quantizer->run(x).get(), plain->run(x).get());
+    }
+}
+
+// big jumps must never be held back
+static void testHysteresisJump() {
+    auto quantizer = makeWithHysteresis(.5f);
+    auto plain = ScaleQuantizer::makeTestCMaj();
+    for (int i = 0; i < 24; ++i) {
+        const float x = float((i * 7) % 24) / 12.f;  // jump around by fifths
+        assertEQ(quantizer->run(x).get(), plain->run(x).get());
+    }
+}
+
 void testScaleQuantizer() {
     testCinC();
     testCinC2();
@@ -66,6 +132,9 @@ void testScaleQuantizer() {
     testFullC();
     testFullG();
     testFullGm();
+    testHysteresisJitter();
+    testHysteresisZero();
+    testHysteresisJump();
 
     // testUpAndDownStep();
 }
\ No newline at end of file
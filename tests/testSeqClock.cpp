@@ -1,4 +1,6 @@
 
+#include <stdlib.h>
+
 #include "OneShot.h"
 #include "SeqClock.h"
 #include "asserts.h"
@@ -541,6 +543,89 @@ static void testResetGoesAway(bool nordMode) {
 }
 
 
+// random voltage, often near the thresholds, sometimes exactly zero
+static float randomGate(float last) {
+    const int r = rand() % 100;
+    if (r < 80) {
+        return last;
+    }
+    const float levels[] = {0, 0, .5f, cGateLow, 1.2f, cGateHi, 2, 10, 10};
+    return levels[rand() % (sizeof(levels) / sizeof(levels[0]))];
+}
+
+// updateBlock has to do exactly what updateOnce on every sample does.
+static void testBlockSameAsOnce(bool nordMode) {
+    SeqClock once;
+    SeqClock block;
+    once.setup(1.f / 44100.f);
+    block.setup(1.f / 44100.f);
+    once.setResetMode(nordMode);
+    block.setResetMode(nordMode);
+
+    const int maxBlock = 70;
+    float clock[maxBlock];
+    float reset[maxBlock];
+    SeqClock::Event events[maxBlock];
+    float lastClock = 0;
+    float lastReset = 0;
+    int totalEvents = 0;
+    for (int pass = 0; pass < 5000; ++pass) {
+        const int numSamples = 1 + rand() % maxBlock;
+        const bool runStop = (rand() % 8) != 0;
+        const bool fewResets = (rand() % 4) != 0;
+        for (int i = 0; i < numSamples; ++i) {
+            lastClock = randomGate(lastClock);
+            if (!fewResets) {
+                lastReset = randomGate(lastReset);
+            }
+            clock[i] = lastClock;
+            reset[i] = lastReset;
+        }
+
+        const int numEvents = block.updateBlock(clock, reset, numSamples, runStop, events);
+        int expectedEvents = 0;
+        for (int i = 0; i < numSamples; ++i) {
+            const bool lastValue = once.getClockValue();
+            const auto x = once.updateOnce(clock[i], runStop, reset[i]);
+            const bool value = once.getClockValue();
+            if (x.didClock || x.didReset || value != lastValue) {
+                assertLT(expectedEvents, numEvents);
+                const SeqClock::Event& event = events[expectedEvents++];
+                assertEQ(event.offset, i);
+                assertEQ(event.results.didClock, x.didClock);
+                assertEQ(event.results.didReset, x.didReset);
+                assertEQ(event.clockValue, value);
+            }
+        }
+        assertEQ(numEvents, expectedEvents);
+        const bool onceValue = once.getClockValue();
+        const bool blockValue = block.getClockValue();
+        assertEQ(blockValue, onceValue);
+        totalEvents += numEvents;
+    }
+    assertGT(totalEvents, 1000);
+}
+
+// long blocks of steady clock, one edge in the middle
+static void testBlockFindsEdge() {
+    SeqClock ck;
+    ck.setup(1.f / 44100.f);
+    float clock[64] = {0};
+    float reset[64] = {0};
+    SeqClock::Event events[64];
+    for (int i = 37; i < 64; ++i) {
+        clock[i] = 10;
+    }
+    int n = ck.updateBlock(clock, reset, 64, true, events);
+    assertEQ(n, 1);
+    assertEQ(events[0].offset, 37);
+    assert(events[0].results.didClock);
+    assert(events[0].clockValue);
+
+    n = ck.updateBlock(clock + 37, reset, 27, true, events);
+    assertEQ(n, 0);
+}
+
 template <typename T>
 void testSeqClock2() {
     testClockExtEdge<T>();
@@ -562,4 +647,7 @@ void testSeqClock() {
     testHysteresis();
     testResetGoesAway(false);
     testResetGoesAway(true);
+    testBlockFindsEdge();
+    testBlockSameAsOnce(false);
+    testBlockSameAsOnce(true);
 }
\ No newline at end of file
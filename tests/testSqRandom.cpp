@@ -0,0 +1,231 @@
+
+#include "ArpegPlayer.h"
+#include "SqRandom.h"
+#include "asserts.h"
+
+static void testSeed() {
+    SqRandom a(7);
+    SqRandom b(7);
+    SqRandom c(8);
+    bool anyDifferent = false;
+    for (int i = 0; i < 100; ++i) {
+        const uint32_t x = a.next();
+        assertEQ(x, b.next());
+        if (x != c.next()) {
+            anyDifferent = true;
+        }
+    }
+    assert(anyDifferent);
+
+    // seeding again starts over
+    SqRandom d(7);
+    const uint32_t first = d.next();
+    d.next();
+    d.setSeed(7);
+    assertEQ(d.next(), first);
+}
+
+static void testBelow() {
+    SqRandom r(1);
+    const int n = 7;
+    int counts[n] = {0};
+    const int tries = 70000;
+    for (int i = 0; i < tries; ++i) {
+        const uint32_t x = r.below(n);
+        assertLT(x, uint32_t(n));
+        ++counts[x];
+    }
+    for (int i = 0; i < n; ++i) {
+        assertClose(counts[i], tries / n, tries / n / 20);
+    }
+    for (int i = 0; i < 100; ++i) {
+        assertEQ(r.below(1), 0);
+    }
+}
+
+// Chi-squared of counts against all the same.
+static double chiSquared(const int* counts, int n, int total) {
+    const double expected = double(total) / n;
+    double sum = 0;
+    for (int i = 0; i < n; ++i) {
+        const double d = counts[i] - expected;
+        sum += d * d / expected;
+    }
+    return sum;
+}
+
+// rank of a permutation of 0..3, 0..23
+static int permutationIndex(const uint8_t* p) {
+    int index = 0;
+    for (int i = 0; i < 4; ++i) {
+        int smallerAfter = 0;
+        for (int j = i + 1; j < 4; ++j) {
+            if (p[j] < p[i]) {
+                ++smallerAfter;
+            }
+        }
+        index = index * (4 - i) + smallerAfter;
+    }
+    return index;
+}
+
+// All 24 orders of 4 things should come up the same number of times.
+static void testShuffleUniform() {
+    SqRandom r(12345);
+    int counts[24] = {0};
+    const int tries = 240000;
+    for (int i = 0; i < tries; ++i) {
+        uint8_t p[4] = {0, 1, 2, 3};
+        r.shuffle(p, 4);
+        ++counts[permutationIndex(p)];
+    }
+    // 23 degrees of freedom, p = .001
+    assertLT(chiSquared(counts, 24, tries), 49.7);
+}
+
+// The 18 orders that don't start with 2 should come up the same number of times.
+static void testShuffleNoRepeatUniform() {
+    SqRandom r(999);
+    int counts[24] = {0};
+    const int tries = 180000;
+    for (int i = 0; i < tries; ++i) {
+        uint8_t p[4] = {0, 1, 2, 3};
+        r.shuffle(p, 4, uint8_t(2));
+        assertNE(p[0], 2);
+        ++counts[permutationIndex(p)];
+    }
+    int allowed[18];
+    int numAllowed = 0;
+    for (int i = 0; i < 24; ++i) {
+        // orders 12..17 start with 2
+        if (i >= 12 && i < 18) {
+            assertEQ(counts[i], 0);
+        } else {
+            allowed[numAllowed++] = counts[i];
+        }
+    }
+    assertEQ(numAllowed, 18);
+    // 17 degrees of freedom, p = .001
+    assertLT(chiSquared(allowed, 18, tries), 40.8);
+}
+
+// With 16 notes, every note should land in every place about as often.
+static void testShufflePositions() {
+    SqRandom r(3);
+    const int n = 16;
+    int counts[n][n] = {{0}};
+    const int tries = 32000;
+    for (int i = 0; i < tries; ++i) {
+        uint8_t p[n];
+        for (int j = 0; j < n; ++j) {
+            p[j] = uint8_t(j);
+        }
+        r.shuffle(p, n);
+        for (int j = 0; j < n; ++j) {
+            ++counts[p[j]][j];
+        }
+    }
+    for (int note = 0; note < n; ++note) {
+        // 15 degrees of freedom, p = .001
+        assertLT(chiSquared(counts[note], n, tries), 37.7);
+    }
+}
+
+static void testShuffleSmall() {
+    SqRandom r(0);
+    uint8_t p[1] = {5};
+    r.shuffle(p, 1, uint8_t(5));
+    assertEQ(p[0], 5);
+    r.shuffle(p, 0);
+}
+
+static void fillNotes(NoteBuffer& nb, int numNotes) {
+    for (int i = 0; i < numNotes; ++i) {
+        nb.push_back(float(i), 0, i);
+    }
+}
+
+// same seed, same notes
+static void testPlayerSeed() {
+    const int numNotes = 8;
+    NoteBuffer nb(numNotes);
+    fillNotes(nb, numNotes);
+    ArpegPlayer a(&nb);
+    ArpegPlayer b(&nb);
+    ArpegPlayer c(&nb);
+    a.setMode(ArpegPlayer::Mode::SHUFFLE);
+    b.setMode(ArpegPlayer::Mode::SHUFFLE);
+    c.setMode(ArpegPlayer::Mode::SHUFFLE);
+    a.setSeed(5);
+    b.setSeed(5);
+    c.setSeed(6);
+
+    float first[numNotes * 4];
+    bool anyDifferent = false;
+    for (int i = 0; i < numNotes * 4; ++i) {
+        a.armReShuffle();
+        b.armReShuffle();
+        c.armReShuffle();
+        first[i] = a.clock().first;
+        assertEQ(b.clock().first, first[i]);
+        if (c.clock().first != first[i]) {
+            anyDifferent = true;
+        }
+    }
+    assert(anyDifferent);
+
+    // reset starts the orders over
+    a.reset();
+    for (int i = 0; i < numNotes * 4; ++i) {
+        a.armReShuffle();
+        assertEQ(a.clock().first, first[i]);
+    }
+}
+
+static void testPlayerNoRepeat() {
+    const int numNotes = 3;
+    NoteBuffer nb(numNotes);
+    fillNotes(nb, numNotes);
+    ArpegPlayer ap(&nb);
+    ap.setMode(ArpegPlayer::Mode::SHUFFLE);
+    ap.setNoRepeat(true);
+    float last = -1;
+    for (int i = 0; i < 3000; ++i) {
+        ap.armReShuffle();
+        const float x = ap.clock().first;
+        assertNE(x, last);
+        last = x;
+    }
+}
+
+// without no repeat, small shuffles will repeat now and then
+static void testPlayerRepeats() {
+    const int numNotes = 3;
+    NoteBuffer nb(numNotes);
+    fillNotes(nb, numNotes);
+    ArpegPlayer ap(&nb);
+    ap.setMode(ArpegPlayer::Mode::SHUFFLE);
+    float last = -1;
+    int repeats = 0;
+    for (int i = 0; i < 3000; ++i) {
+        ap.armReShuffle();
+        const float x = ap.clock().first;
+        if (x == last) {
+            ++repeats;
+        }
+        last = x;
+    }
+    assertGT(repeats, 0);
+}
+
+void testSqRandom() {
+    testSeed();
+    testBelow();
+    testShuffleUniform();
+    testShuffleNoRepeatUniform();
+    testShufflePositions();
+    testShuffleSmall();
+    testPlayerSeed();
+    testPlayerNoRepeat();
+    testPlayerRepeats();
+}
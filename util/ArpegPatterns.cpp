@@ -0,0 +1,184 @@
+#include "ArpegPatterns.h"
+
+#include <assert.h>
+
+#include "ArpegPlayer.h"
+
+using Mode = ArpegPlayer::Mode;
+
+const ArpegPatterns& ArpegPatterns::instance() {
+    static const ArpegPatterns patterns;
+    return patterns;
+}
+
+const ArpegPatterns::Pattern& ArpegPatterns::get(int mode, int numNotes) {
+    assert(mode >= 0 && mode < numModes);
+    assert(numNotes >= 0 && numNotes <= NoteBuffer::maxCapacity);
+    return instance().patterns[mode][numNotes];
+}
+
+ArpegPatterns::ArpegPatterns() {
+    // first pass to find the offsets, so the pointers don't move when the vectors grow
+    uint8_t buffer[maxSteps];
+    int offsets[numModes][NoteBuffer::maxCapacity + 1];
+    int firstOffsets[numModes][NoteBuffer::maxCapacity + 1];
+    int totalSteps = 0;
+    int totalNotes = 0;
+    for (int mode = 0; mode < numModes; ++mode) {
+        for (int numNotes = 0; numNotes <= NoteBuffer::maxCapacity; ++numNotes) {
+            offsets[mode][numNotes] = totalSteps;
+            firstOffsets[mode][numNotes] = totalNotes;
+            totalSteps += fill(mode, numNotes, buffer);
+            totalNotes += numNotes;
+        }
+    }
+
+    steps.resize(totalSteps);
+    firstSteps.resize(totalNotes);
+    noOctaves.resize(maxSteps, 0);
+    for (int mode = 0; mode < numModes; ++mode) {
+        for (int numNotes = 0; numNotes <= NoteBuffer::maxCapacity; ++numNotes) {
+            Pattern& pattern = patterns[mode][numNotes];
+            uint8_t* dest = steps.data() + offsets[mode][numNotes];
+            uint8_t* first = firstSteps.data() + firstOffsets[mode][numNotes];
+            pattern.size = fill(mode, numNotes, dest);
+            pattern.steps = dest;
+            pattern.octaves = noOctaves.data();
+            pattern.firstStep = first;
+
+            for (int i = 0; i < numNotes; ++i) {
+                first[i] = 0;
+            }
+            bool found[NoteBuffer::maxCapacity] = {false};
+            for (int step = 0; step < pattern.size; ++step) {
+                const int note = dest[step];
+                if (!found[note]) {
+                    found[note] = true;
+                    first[note] = uint8_t(step);
+                }
+            }
+            // every mode plays every note
+            for (int i = 0; i < numNotes; ++i) {
+                assert(found[i]);
+            }
+        }
+    }
+}
+
+int ArpegPatterns::fill(int m, int siz, uint8_t* dest) {
+    assert(siz >= 0 && siz <= NoteBuffer::maxCapacity);
+    switch (Mode(m)) {
+        case Mode::UP:
+        case Mode::ORDER_PLAYED:
+        case Mode::SHUFFLE:
+            for (int i = 0; i < siz; ++i) {
+                dest[i] = uint8_t(i);
+            }
+            return siz;
+        case Mode::DOWN:
+            for (int i = 0; i < siz; ++i) {
+                dest[i] = uint8_t(siz - 1 - i);
+            }
+            return siz;
+        case Mode::UPDOWN: {
+            // extremes play once
+            for (int i = 0; i < siz; ++i) {
+                dest[i] = uint8_t(i);
+            }
+            const int downwardEntries = siz - 2;
+            if (downwardEntries <= 0) {
+                return siz;
+            }
+            for (int i = 0; i < downwardEntries; ++i) {
+                dest[i + siz] = uint8_t(siz - (i + 2));
+            }
+            return 2 * siz - 2;
+        }
+        case Mode::DOWNUP: {
+            for (int i = 0; i < siz; ++i) {
+                dest[i] = uint8_t(siz - 1 - i);
+            }
+            const int upwardEntries = siz - 2;
+            if (upwardEntries <= 0) {
+                return siz;
+            }
+            for (int i = 0; i < upwardEntries; ++i) {
+                dest[i + siz] = uint8_t(1 + i);
+            }
+            return 2 * siz - 2;
+        }
+        case Mode::UP_DOWN_DBL:
+            // extremes play twice
+            for (int i = 0; i < siz; ++i) {
+                dest[i] = uint8_t(i);
+                dest[i + siz] = uint8_t(siz - 1 - i);
+            }
+            return 2 * siz;
+        case Mode::DOWN_UP_DBL:
+            for (int i = 0; i < siz; ++i) {
+                dest[i] = uint8_t(siz - 1 - i);
+                dest[i + siz] = uint8_t(i);
+            }
+            return 2 * siz;
+        case Mode::INSIDE_OUT: {
+            if (siz < 1) {
+                return 0;
+            }
+            // start at the middle. Odd sizes go up first, even go down first.
+            const bool isOdd = siz & 1;
+            const int medianIndex = siz / 2;
+            int lowIndex = medianIndex;
+            int highIndex = medianIndex;
+            int destIndex = 0;
+            dest[destIndex++] = uint8_t(medianIndex);
+            while (destIndex < siz) {
+                ++highIndex;
+                --lowIndex;
+                if (isOdd && highIndex < siz) {
+                    dest[destIndex++] = uint8_t(highIndex);
+                }
+                if (lowIndex >= 0) {
+                    dest[destIndex++] = uint8_t(lowIndex);
+                }
+                if (!isOdd && highIndex < siz) {
+                    dest[destIndex++] = uint8_t(highIndex);
+                }
+            }
+            return siz;
+        }
+        case Mode::OUTSIDE_IN: {
+            // high, low, next high, next low... then the middle if there is one
+            int destIndex = 0;
+            for (int i = 0; i < siz / 2; ++i) {
+                dest[destIndex++] = uint8_t(siz - 1 - i);
+                dest[destIndex++] = uint8_t(i);
+            }
+            if (siz & 1) {
+                dest[destIndex++] = uint8_t(siz / 2);
+            }
+            return siz;
+        }
+        case Mode::REPEAT_BOTTOM:
+            if (siz < 2) {
+                dest[0] = 0;
+                return siz;
+            }
+            for (int i = 0; i < siz - 1; ++i) {
+                dest[i * 2] = 0;
+                dest[i * 2 + 1] = uint8_t(1 + i);
+            }
+            return 2 * (siz - 1);
+        case Mode::REPEAT_TOP:
+            if (siz < 2) {
+                dest[0] = 0;
+                return siz;
+            }
+            for (int i = 0; i < siz - 1; ++i) {
+                dest[i * 2] = uint8_t(siz - 1);
+                dest[i * 2 + 1] = uint8_t(i);
+            }
+            return 2 * (siz - 1);
+    }
+    assert(false);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "NoteBuffer.h"
+
+/**
+ * The order the arpeggiator plays notes in, for every mode and
+ * every number of notes up to NoteBuffer::maxCapacity.
+ *
+ * A step is an index into the notes sorted low to high, so when notes
+ * come and go, or the mode changes, the player just picks a different
+ * pattern instead of building a new one.
+ *
+ * All built once, the first time they are asked for.
+ */
+class ArpegPatterns {
+public:
+    class Pattern {
+    public:
+        const uint8_t* steps = nullptr;      // index into the sorted notes
+        const int8_t* octaves = nullptr;     // added to each step. All zero for the built-in modes
+        const uint8_t* firstStep = nullptr;  // first step that plays each sorted note, may be null
+        int size = 0;
+    };
+
+    /**
+     * mode is an ArpegPlayer::Mode.
+     * ORDER_PLAYED and SHUFFLE get a plain count up, the player picks the notes.
+     */
+    static const Pattern& get(int mode, int numNotes);
+
+    /**
+     * Builds the steps for one pattern, returns how many.
+     * dest must have room for maxSteps.
+     */
+    static int fill(int mode, int numNotes, uint8_t* dest);
+
+    static const int numModes = 12;
+    static const int maxSteps = 2 * NoteBuffer::maxCapacity;
+
+private:
+    ArpegPatterns();
+    static const ArpegPatterns& instance();
+
+    std::vector<uint8_t> steps;
+    std::vector<uint8_t> firstSteps;
+    std::vector<int8_t> noOctaves;
+    Pattern patterns[numModes][NoteBuffer::maxCapacity + 1];
+};
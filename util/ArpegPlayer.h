@@ -1,10 +1,12 @@
 #pragma once
 
+#include "ArpegPatterns.h"
+#include "ArpegProgram.h"
 #include "AudioMath.h"
 #include "NoteBuffer.h"
+#include "SqRandom.h"
 
 #include <algorithm>
-#include <random>
 #include <string>
 #include <vector>
 
@@ -41,6 +43,26 @@ public:
     bool empty() const;
 
     void setMode(Mode m);
+
+    /**
+     * Play a user pattern instead of the mode. nullptr goes back to the mode.
+     * The caller owns the program, and must keep it around until it's replaced.
+     */
+    void setProgram(const ArpegProgram* p);
+
+    /**
+     * Shuffle mode plays the same orders every time for a given seed.
+     * reset() starts the orders over from the beginning.
+     */
+    void setSeed(uint32_t seed);
+
+    /**
+     * If true, a new shuffle won't start with the note the last one ended on.
+     */
+    void setNoRepeat(bool b) {
+        noRepeat = b;
+    }
+
     static std::vector<std::string> modes() {
         return {"up", "down", "up+down", "down+up", "up then down", "down then up", "inside-out", "outside-in",
                 "order played", "repeat low", "repeat high", "shuffle"};
@@ -56,35 +78,32 @@ public:
 private:
   
     bool dataChanged = true;
+    unsigned lastChangeCount = 0;
     NoteBuffer* const noteBuffer = nullptr;
     Mode mode{Mode::UP};
+    const ArpegProgram* program = nullptr;
 
-    // use std C here
-   // AudioMath::RandomUniformFunc random = {AudioMath::random()};
-    std::mt19937 randomGenerator{1234567891};
+    uint32_t seed = 0;
+    SqRandom random{seed};
+    bool noRepeat = false;
 
-    std::pair<float, float> playbackBuffer[4 + 2 * (1 + NoteBuffer::maxCapacity)];
-    std::pair<float, float>  sortBuffer[NoteBuffer::maxCapacity];
+    // Playback reads the notes through the pattern, nothing is copied
+    // except for the modes that don't go by pitch.
+    const ArpegPatterns::Pattern* pattern = nullptr;
+    std::pair<float, float> orderBuffer[NoteBuffer::maxCapacity];  // notes in the order played
+    uint8_t shuffleSteps[NoteBuffer::maxCapacity];                // index into orderBuffer
     int playbackIndex = -1;
     int playbackSize = 0;
+    float nextPitch = -100;  // what playbackIndex pointed at before the data changed
     bool reFillOnIndexArmed = false;
 
     void onIndexWrapAround();
 
-    void udpatePlayback();
-    void checkUpdatePlayback();
-    void copyAndSort();
+    bool usesOrderPlayed() const {
+        return !program && ((mode == Mode::ORDER_PLAYED) || (mode == Mode::SHUFFLE));
+    }
+    std::pair<float, float> noteAt(int index) const;
+    int findPitch(float pitch) const;
     void refillPlayback();
-    void refillPlaybackUP();
-    void refillPlaybackDOWN();
-    void refillPlaybackUPDOWN();
-    void refillPlaybackDOWNUP();
-    void refillPlaybackDOWN_UP_DBL();
-    void refillPlaybackUP_DOWN_DBL();
-    void refillPlaybackINSIDE_OUT();
-    void refillPlaybackOUTSIDE_IN();
-    void refillPlaybackORDER_PLAYED();
-    void refillPlaybackREPEAT_BOTTOM();
-    void refillPlaybackREPEAT_TOP();
-    void refillPlaybackSHUFFLE();
+    void shuffle(bool wrapped);
 };
@@ -0,0 +1,256 @@
+#include "ArpegProgram.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+#include <memory>
+
+#include "ArpegPlayer.h"
+
+using Mode = ArpegPlayer::Mode;
+
+class ArpegProgram::Parser {
+public:
+    Parser(std::vector<Item>& out, std::string& err) : items(out), error(err) {}
+    bool parse(const std::string& text);
+
+private:
+    std::vector<Item>& items;
+    std::string& error;
+    std::vector<std::string> tokens;
+    int octave = 0;
+    int atomsParsed = 0;
+
+    void tokenize(const std::string& text);
+    bool parseList(int& pos, bool inGroup);
+    bool parseItem(int& pos);
+    bool parseAtom(int& pos);
+    static bool parseRepeat(const std::string& token, int& count);
+    static int findMode(const std::string& token);
+};
+
+void ArpegProgram::Parser::tokenize(const std::string& text) {
+    std::string token;
+    for (char c : text) {
+        const bool isParen = (c == '(') || (c == ')');
+        if (isspace(c) || isParen) {
+            if (!token.empty()) {
+                tokens.push_back(token);
+                token.clear();
+            }
+            if (isParen) {
+                tokens.push_back(std::string(1, c));
+            }
+        } else {
+            token += char(tolower(c));
+        }
+    }
+    if (!token.empty()) {
+        tokens.push_back(token);
+    }
+}
+
+bool ArpegProgram::Parser::parse(const std::string& text) {
+    tokenize(text);
+    int pos = 0;
+    if (!parseList(pos, false)) {
+        return false;
+    }
+    if (items.empty()) {
+        error = "no notes";
+        return false;
+    }
+    return true;
+}
+
+bool ArpegProgram::Parser::parseList(int& pos, bool inGroup) {
+    while (pos < int(tokens.size())) {
+        if (tokens[pos] == ")") {
+            if (!inGroup) {
+                error = "unexpected )";
+                return false;
+            }
+            return true;
+        }
+        if (!parseItem(pos)) {
+            return false;
+        }
+    }
+    if (inGroup) {
+        error = "missing )";
+        return false;
+    }
+    return true;
+}
+
+// An atom, then maybe a repeat. Repeats parse the atom again, so "(1 +oct) x3" climbs.
+bool ArpegProgram::Parser::parseItem(int& pos) {
+    const int start = pos;
+    if (!parseAtom(pos)) {
+        return false;
+    }
+    int count = 1;
+    if ((pos < int(tokens.size())) && parseRepeat(tokens[pos], count)) {
+        if (count < 1 || count > maxRepeat) {
+            error = "bad repeat " + tokens[pos];
+            return false;
+        }
+        const int end = pos + 1;
+        for (int i = 1; i < count; ++i) {
+            int again = start;
+            if (!parseAtom(again)) {
+                return false;
+            }
+        }
+        pos = end;
+    }
+    return true;
+}
+
+bool ArpegProgram::Parser::parseAtom(int& pos) {
+    // nested repeats of things that make no notes could go on a long time
+    if (++atomsParsed > 8 * maxSteps) {
+        error = "too long";
+        return false;
+    }
+    const std::string& token = tokens[pos++];
+    if (token == "(") {
+        if (!parseList(pos, true)) {
+            return false;
+        }
+        ++pos;  // skip the )
+        return true;
+    }
+    if (token == "+oct" || token == "-oct") {
+        octave += (token[0] == '+') ? 1 : -1;
+        if (octave > maxOctave || octave < -maxOctave) {
+            error = "too many octaves";
+            return false;
+        }
+        return true;
+    }
+    int count = 0;
+    if (parseRepeat(token, count)) {
+        error = token + " with nothing to repeat";
+        return false;
+    }
+
+    // too many items would be too many steps anyway. Stops runaway repeats.
+    if (int(items.size()) >= maxSteps) {
+        error = "too long";
+        return false;
+    }
+
+    Item item;
+    item.octave = octave;
+    const int mode = findMode(token);
+    if (mode >= 0) {
+        item.isMode = true;
+        item.value = mode;
+        items.push_back(item);
+        return true;
+    }
+
+    char* end = nullptr;
+    const long note = strtol(token.c_str(), &end, 10);
+    if (*end || end == token.c_str() || note == 0 || note > NoteBuffer::maxCapacity || note < -NoteBuffer::maxCapacity) {
+        error = "don't understand " + token;
+        return false;
+    }
+    item.value = int(note);
+    items.push_back(item);
+    return true;
+}
+
+bool ArpegProgram::Parser::parseRepeat(const std::string& token, int& count) {
+    if (token.size() < 2 || token[0] != 'x') {
+        return false;
+    }
+    for (size_t i = 1; i < token.size(); ++i) {
+        if (!isdigit(token[i])) {
+            return false;
+        }
+    }
+    count = atoi(token.c_str() + 1);
+    return true;
+}
+
+int ArpegProgram::Parser::findMode(const std::string& token) {
+    const auto names = ArpegPlayer::shortModes();
+    for (int i = 0; i < int(names.size()); ++i) {
+        if (Mode(i) == Mode::ORDER_PLAYED || Mode(i) == Mode::SHUFFLE) {
+            // these don't go by pitch
+            continue;
+        }
+        if (token == names[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ArpegProgram* ArpegProgram::compile(const std::string& text, std::string& error) {
+    std::unique_ptr<ArpegProgram> program(new ArpegProgram());
+    program->text = text;
+    Parser parser(program->items, error);
+    if (!parser.parse(text)) {
+        return nullptr;
+    }
+
+    // first pass to find the sizes, so the pointers don't move when the vectors grow
+    int offsets[NoteBuffer::maxCapacity + 1];
+    int totalSteps = 0;
+    for (int numNotes = 0; numNotes <= NoteBuffer::maxCapacity; ++numNotes) {
+        offsets[numNotes] = totalSteps;
+        const int size = program->fill(numNotes, nullptr, nullptr);
+        if (size > maxSteps) {
+            error = "too long";
+            return nullptr;
+        }
+        totalSteps += size;
+    }
+
+    program->steps.resize(totalSteps);
+    program->octaves.resize(totalSteps);
+    for (int numNotes = 0; numNotes <= NoteBuffer::maxCapacity; ++numNotes) {
+        ArpegPatterns::Pattern& pattern = program->patterns[numNotes];
+        pattern.steps = program->steps.data() + offsets[numNotes];
+        pattern.octaves = program->octaves.data() + offsets[numNotes];
+        pattern.size = program->fill(numNotes, program->steps.data() + offsets[numNotes], program->octaves.data() + offsets[numNotes]);
+        // a note can play more than once at different octaves, so no lookup table.
+        pattern.firstStep = nullptr;
+    }
+    error.clear();
+    return program.release();
+}
+
+// Steps for numNotes, returns how many. With null dest just counts.
+int ArpegProgram::fill(int numNotes, uint8_t* destSteps, int8_t* destOctaves) const {
+    if (numNotes == 0) {
+        return 0;
+    }
+    int size = 0;
+    uint8_t noteStep[1];
+    for (const Item& item : items) {
+        int count = 1;
+        const uint8_t* src = noteStep;
+        if (item.isMode) {
+            const ArpegPatterns::Pattern& pattern = ArpegPatterns::get(item.value, numNotes);
+            src = pattern.steps;
+            count = pattern.size;
+        } else if (item.value > 0) {
+            noteStep[0] = uint8_t((item.value - 1) % numNotes);
+        } else {
+            noteStep[0] = uint8_t(numNotes - 1 - ((-item.value - 1) % numNotes));
+        }
+        if (destSteps && (size + count <= maxSteps)) {
+            for (int i = 0; i < count; ++i) {
+                destSteps[size + i] = src[i];
+                destOctaves[size + i] = int8_t(item.octave);
+            }
+        }
+        size += count;
+    }
+    return size;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "ArpegPatterns.h"
+#include "NoteBuffer.h"
+
+/**
+ * A pattern the user typed in, like "1 3 2 4 +oct 1".
+ *
+ * Compiled once, off the audio thread, into the same step tables the
+ * built-in modes use, one for every number of notes. The player runs
+ * it just like a built-in mode.
+ *
+ * The text is a list of:
+ *      1, 2, 3...      notes counting up from the lowest held. Wraps around if there aren't that many.
+ *      -1, -2...       notes counting down from the highest.
+ *      up, down...     a whole built-in mode, by its short name. Not "in order" or "shuffle".
+ *      +oct, -oct      everything after moves up or down an octave.
+ *      ( ... )         a group.
+ *      x3              play what came before three times.
+ */
+class ArpegProgram {
+public:
+    /**
+     * @returns nullptr if text doesn't compile, and error says why.
+     * Allocates, so don't call it from the audio thread.
+     */
+    static ArpegProgram* compile(const std::string& text, std::string& error);
+
+    const ArpegPatterns::Pattern& get(int numNotes) const {
+        assert(numNotes >= 0 && numNotes <= NoteBuffer::maxCapacity);
+        return patterns[numNotes];
+    }
+
+    const std::string& getText() const { return text; }
+
+    static const int maxSteps = 1024;  // for any one number of notes
+    static const int maxRepeat = 64;
+    static const int maxOctave = 4;
+
+private:
+    ArpegProgram() {}
+
+    // a note or a mode, after groups and repeats are expanded
+    class Item {
+    public:
+        bool isMode = false;
+        int value = 0;  // note number as typed, or ArpegPlayer::Mode
+        int octave = 0;
+    };
+
+    class Parser;
+    int fill(int numNotes, uint8_t* steps, int8_t* octaves) const;
+
+    std::string text;
+    std::vector<Item> items;
+    std::vector<uint8_t> steps;
+    std::vector<int8_t> octaves;
+    ArpegPatterns::Pattern patterns[NoteBuffer::maxCapacity + 1];
+};
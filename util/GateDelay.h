@@ -10,30 +10,75 @@
 
 #include <assert.h>
 
-#include "SchmidtTrigger.h"
+#include <algorithm>
+#include <cmath>
+
+#include "SchmidtTriggerBank.h"
 #include "SqLog.h"
 #include "SqRingBuffer.h"
 
+/**
+ * Holds back gates until their CV is ready.
+ *
+ * FIXED delays every gate by 5 samples, which covers CV that is patched
+ * through a few more modules than its gate.
+ * ADAPTIVE watches the CV after a gate goes high, and lets the gate through
+ * as soon as the CV has stopped moving. If the CV didn't move anywhere near
+ * the gate, it waits quietSamples in case the CV is late. Slow CV is cut off
+ * at maxMs. Gates going low are never held.
+ */
 class GateDelay {
 public:
+    enum class Mode {
+        NONE,
+        FIXED,
+        ADAPTIVE
+    };
+
     GateDelay();
-    void process(Input&, unsigned numChannels);
+
+    /**
+     * @param cv is only used for ADAPTIVE. With one gate channel and more cv channels,
+     * the gate waits for all of them.
+     */
+    void process(Input& gate, unsigned numChannels, Input* cv = nullptr, unsigned numCvChannels = 0);
     bool getGate(unsigned channel);
     void enableDelay(bool enabled);
+    void setMode(Mode m);
+    void setSampleRate(float sampleRate);
+
+    static const int quietSamples = 4;
+    static constexpr float maxMs = 2;
+    static constexpr float stillVolts = .0005f;  // less than 1/100 of a semitone
+
+    /**
+     * All 16 gates, bit n is channel n.
+     */
+    unsigned getGates() const { return gates; }
 
 private:
-    SchmidtTrigger inputCondition[16];
-    bool gates[16]{false};
+    SchmidtTriggerBank inputCondition;
+    unsigned gates = 0;
     static const int size = 5;
 
 
     // unsigned delay
     // template <typename T, int SIZE>
     SqRingBuffer<unsigned, size+1> delay;
-    bool doDelay = false;
-    
+    Mode mode = Mode::NONE;
+
+    // for ADAPTIVE
+    static const int longTime = 1 << 20;
+    unsigned lastInput = 0;  // gates before the delay
+    unsigned pending = 0;    // high, but waiting for cv
+    int waited[16] = {0};
+    float lastCv[16] = {0};
+    int sinceCvChange[16];
+    int maxSamples = 1;
+
     void processDelay(Input&, unsigned numChannels);
     void processNoDelay(Input&, unsigned numChannels);
+    void processAdaptive(Input& gate, unsigned numChannels, Input* cv, unsigned numCvChannels);
 };
 
 // Turn the ring buffer into a delay line by pushing enough zeros into it
@@ -45,50 +90,114 @@ inline GateDelay::GateDelay() {
         // SQINFO("ctor of gate dela pushed one here is buffer");
         //ringBuffer._dump();
     }
+    for (int i = 0; i < 16; ++i) {
+        sinceCvChange[i] = longTime;
+    }
+    setSampleRate(44100);
 }
 
 inline bool GateDelay::getGate(unsigned channel) {
-    assert(channel <= 16);
-    return gates[channel];
+    assert(channel < 16);
+    return gates & (1u << channel);
 }
 
 inline void GateDelay::enableDelay(bool enabled) {
-    doDelay = enabled;
+    setMode(enabled ? Mode::FIXED : Mode::NONE);
 }
 
-inline void GateDelay::process(Input& input, unsigned numChannels) {
-    if (doDelay) {
-        processDelay(input, numChannels);
-    } else {
-        processNoDelay(input, numChannels);
+inline void GateDelay::setMode(Mode m) {
+    if (m == Mode::ADAPTIVE && mode != Mode::ADAPTIVE) {
+        // gates already through stay through
+        lastInput = gates;
+        pending = 0;
     }
+    mode = m;
 }
 
+inline void GateDelay::setSampleRate(float sampleRate) {
+    maxSamples = std::max(1, int(std::round(sampleRate * maxMs / 1000.f)));
+}
+
+inline void GateDelay::process(Input& input, unsigned numChannels, Input* cv, unsigned numCvChannels) {
+    switch (mode) {
+        case Mode::NONE:
+            processNoDelay(input, numChannels);
+            break;
+        case Mode::FIXED:
+            processDelay(input, numChannels);
+            break;
+        case Mode::ADAPTIVE:
+            processAdaptive(input, numChannels, cv, numCvChannels);
+            break;
+    }
+}
+
+// channels we aren't processing keep their old gates
 inline void GateDelay::processDelay(Input& input, unsigned numChannels) {
     assert(numChannels <= 16);
-    unsigned x = 0;
-    for (unsigned i = 0; i < numChannels; ++i) {
-        const bool gate = inputCondition[i].go(input.getVoltage(i));
-        if (gate) {
-            x |= (1 << i);
-        }
-    }
+    const unsigned mask = SchmidtTriggerBank::channelMask(numChannels);
+    const unsigned x = inputCondition.go(input.getVoltages(), numChannels) & mask;
 
     if (!delay.empty()) {
         auto y = delay.pop();
-        for (unsigned i = 0; i < numChannels; ++i) {
-            gates[i] = y & (1 << i);
-        }
+        gates = (gates & ~mask) | (y & mask);
     }
     delay.push(x);
 }
 
 inline void GateDelay::processNoDelay(Input& input, unsigned numChannels) {
     assert(numChannels <= 16);
-    for (unsigned i = 0; i < numChannels; ++i) {
-        // auto x = input.getVoltage(i);
-        const bool gate = inputCondition[i].go(input.getVoltage(i));
-        // SQINFO("input(%d) = %f gate=%d", i, input.getVoltage(i), gate);
-        gates[i] = gate;
+    const unsigned mask = SchmidtTriggerBank::channelMask(numChannels);
+    const unsigned x = inputCondition.go(input.getVoltages(), numChannels);
+    gates = (gates & ~mask) | (x & mask);
+}
+
+inline void GateDelay::processAdaptive(Input& input, unsigned numChannels, Input* cv, unsigned numCvChannels) {
+    assert(numChannels <= 16);
+    assert(numCvChannels <= 16);
+    const unsigned mask = SchmidtTriggerBank::channelMask(numChannels);
+    const unsigned x = inputCondition.go(input.getVoltages(), numChannels) & mask;
+
+    // how long since each cv moved
+    int sinceAnyCvChange = longTime;
+    if (cv) {
+        const float* voltages = cv->getVoltages();
+        for (unsigned i = 0; i < numCvChannels; ++i) {
+            if (std::abs(voltages[i] - lastCv[i]) > stillVolts) {
+                lastCv[i] = voltages[i];
+                sinceCvChange[i] = 0;
+            } else if (sinceCvChange[i] < longTime) {
+                ++sinceCvChange[i];
+            }
+            sinceAnyCvChange = std::min(sinceAnyCvChange, sinceCvChange[i]);
+        }
+    }
+    const bool oneGateForAll = (numChannels == 1) && (numCvChannels > 1);
+
+    const unsigned rising = x & ~lastInput & mask;
+    lastInput = (lastInput & ~mask) | x;
+    pending = (pending | rising) & lastInput;
+
+    for (unsigned i = 0; pending && i < numChannels; ++i) {
+        const unsigned bit = 1u << i;
+        if (!(pending & bit)) {
+            continue;
+        }
+        if (rising & bit) {
+            waited[i] = 0;
+        }
+        int since = longTime;
+        if (oneGateForAll) {
+            since = sinceAnyCvChange;
+        } else if (cv && i < numCvChannels) {
+            since = sinceCvChange[i];
+        }
+        const int w = waited[i]++;
+        const bool still = since > 0;
+        const bool movedNearGate = since <= w + quietSamples;
+        if ((w >= maxSamples) || (still && (movedNearGate || w >= quietSamples))) {
+            pending &= ~bit;
+        }
     }
-}
\ No newline at end of file
+    gates = (gates & ~mask) | (x & ~pending);
+}
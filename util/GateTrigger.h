@@ -72,6 +72,15 @@ public:
         return _trigger;
     }
 
+    /**
+     * true if go() with an input that doesn't cross a threshold
+     * would leave everything but trigger() the same.
+     */
+    bool steady() const
+    {
+        return !_reset && (_gate == _sc.get());
+    }
+
     float thhi() const
     {
         return _sc.thhi();
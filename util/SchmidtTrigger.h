@@ -26,6 +26,11 @@ public:
         return _lastOut;
     }
 
+    bool get() const
+    {
+        return _lastOut;
+    }
+
     float thhi() const
     {
         return _thHi;
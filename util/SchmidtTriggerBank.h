@@ -0,0 +1,66 @@
+#pragma once
+
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define _SCHMIDT_SSE
+#include <emmintrin.h>
+#endif
+
+#include "Constants.h"
+
+/**
+ * 16 SchmidtTriggers, one for each channel of a poly port.
+ * Gates come back as a bitmask, bit n is channel n.
+ *
+ * Each group of four channels is two compares and two movemasks with SSE.
+ * Other platforms get the same logic one channel at a time.
+ */
+class SchmidtTriggerBank {
+public:
+    /**
+     * @param voltages must have room for 16, even if numChannels is less.
+     * Channels at numChannels and up are left as they were.
+     * @returns the gates for all 16 channels.
+     */
+    unsigned go(const float* voltages, unsigned numChannels);
+
+    unsigned get() const {
+        return state;
+    }
+
+    static unsigned channelMask(unsigned numChannels) {
+        assert(numChannels <= 16);
+        return (1u << numChannels) - 1;
+    }
+
+private:
+    unsigned state = 0;
+};
+
+inline unsigned SchmidtTriggerBank::go(const float* voltages, unsigned numChannels) {
+    unsigned above = 0;  // over the high threshold
+    unsigned below = 0;  // under the low threshold
+#ifdef _SCHMIDT_SSE
+    const __m128 hi = _mm_set1_ps(cGateHi);
+    const __m128 lo = _mm_set1_ps(cGateLow);
+    for (unsigned i = 0; i < 16; i += 4) {
+        const __m128 v = _mm_loadu_ps(voltages + i);
+        above |= unsigned(_mm_movemask_ps(_mm_cmpgt_ps(v, hi))) << i;
+        below |= unsigned(_mm_movemask_ps(_mm_cmplt_ps(v, lo))) << i;
+    }
+#else
+    for (unsigned i = 0; i < numChannels; ++i) {
+        if (voltages[i] > cGateHi) {
+            above |= 1u << i;
+        } else if (voltages[i] < cGateLow) {
+            below |= 1u << i;
+        }
+    }
+#endif
+    // high stays high until it goes below, low stays low until it goes above
+    const unsigned next = (state & ~below) | above;
+    const unsigned mask = channelMask(numChannels);
+    state = (state & ~mask) | (next & mask);
+    return state;
+}
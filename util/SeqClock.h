@@ -1,5 +1,10 @@
 #pragma once
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define _SEQCLOCK_SSE
+#include <emmintrin.h>
+#endif
+
 #include <string>
 #include <vector>
 
@@ -35,6 +40,27 @@ public:
     ClockResults updateMulti(int samplesElapsed, float externalClock, bool runStop, float reset);
     ClockResults updateOnce(float externalClock, bool runStop, float reset);
 
+    /**
+     * Something that happened in updateBlock.
+     */
+    class Event {
+    public:
+        int offset = 0;  // sample in the block
+        ClockResults results;
+        bool clockValue = false;  // getClockValue() after this sample
+    };
+
+    /**
+     * Same as calling updateOnce for every sample, but only the samples where
+     * clock or reset cross a threshold get run through updateOnce. The rest are
+     * skipped over four at a time.
+     *
+     * @param events must have room for numSamples. Gets every sample that
+     *      clocked, reset, or changed the clock value.
+     * @returns the number of events.
+     */
+    int updateBlock(const float* externalClock, const float* reset, int numSamples, bool runStop, Event* events);
+
     // sample time is seconds for one sample
     void setup(float sampleTime);
 
@@ -59,6 +85,12 @@ private:
     GateTrigger resetProcessor;
     OneShot resetLockout;
     bool nordResetRequested = false;
+
+    /**
+     * First sample from begin that would flip a SchmidtTrigger that is now
+     * at level. end if none.
+     */
+    static int findFlip(const float* input, int begin, int end, bool level, float thLo, float thHi);
 };
 
 // We don't want reset logic on clock, as clock high should not be ignored.
@@ -133,6 +165,64 @@ inline SeqClock::ClockResults SeqClock::updateOnce(float externalClock, bool run
     return results;
 }
 
+inline int SeqClock::updateBlock(const float* externalClock, const float* reset, int numSamples, bool runStop, Event* events) {
+    int numEvents = 0;
+    int i = 0;
+    while (i < numSamples) {
+        // If nothing is counting, and the triggers agree with their inputs,
+        // samples that don't cross a threshold don't do anything.
+        const bool canSkip = resetLockout.hasFired() &&
+                             resetProcessor.steady() &&
+                             (!runStop || clockProcessor.steady());
+        if (canSkip) {
+            int next = findFlip(reset, i, numSamples, resetProcessor.gate(), resetProcessor.thlo(), resetProcessor.thhi());
+            if (runStop) {
+                next = findFlip(externalClock, i, next, clockProcessor.gate(), clockProcessor.thlo(), clockProcessor.thhi());
+            }
+            i = next;
+            if (i >= numSamples) {
+                break;
+            }
+        }
+
+        const bool lastValue = clockProcessor.gate();
+        const auto results = updateOnce(externalClock[i], runStop, reset[i]);
+        const bool value = clockProcessor.gate();
+        if (results.didClock || results.didReset || (value != lastValue)) {
+            Event& event = events[numEvents++];
+            event.offset = i;
+            event.results = results;
+            event.clockValue = value;
+        }
+        ++i;
+    }
+    return numEvents;
+}
+
+inline int SeqClock::findFlip(const float* input, int begin, int end, bool level, float thLo, float thHi) {
+    int i = begin;
+#ifdef _SEQCLOCK_SSE
+    const __m128 threshold = _mm_set1_ps(level ? thLo : thHi);
+    for (; i + 4 <= end; i += 4) {
+        const __m128 v = _mm_loadu_ps(input + i);
+        const int flips = _mm_movemask_ps(level ? _mm_cmplt_ps(v, threshold) : _mm_cmpgt_ps(v, threshold));
+        if (flips) {
+            int first = 0;
+            while (!(flips & (1 << first))) {
+                ++first;
+            }
+            return i + first;
+        }
+    }
+#endif
+    for (; i < end; ++i) {
+        if (level ? (input[i] < thLo) : (input[i] > thHi)) {
+            return i;
+        }
+    }
+    return end;
+}
+
 inline void SeqClock::setup(float sampleTime) {
     sampleTime = sampleTime;
     resetLockout.setSampleTime(sampleTime);
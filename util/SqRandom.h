@@ -0,0 +1,114 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+
+/**
+ * Small, fast random numbers: xoshiro128**, 16 bytes of state.
+ * The same seed always gives the same numbers, on any platform.
+ *
+ * Never allocates, so it is fine to use on the audio thread.
+ */
+class SqRandom {
+public:
+    explicit SqRandom(uint32_t seed = 0) {
+        setSeed(seed);
+    }
+
+    /**
+     * Seeds go through splitmix64, so seeds next to each other
+     * give sequences that have nothing to do with each other.
+     */
+    void setSeed(uint32_t seed);
+
+    uint32_t next();
+
+    /**
+     * @returns 0..n-1, all equally likely.
+     */
+    uint32_t below(uint32_t n);
+
+    /**
+     * Fisher-Yates: one pass, in place. Every order equally likely.
+     */
+    template <typename T>
+    void shuffle(T* data, int size);
+
+    /**
+     * Same, but data[0] won't be notFirst, unless it's the only thing there.
+     * Every order that obeys that is equally likely.
+     */
+    template <typename T>
+    void shuffle(T* data, int size, T notFirst);
+
+private:
+    uint32_t state[4];
+
+    static uint32_t rotl(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+};
+
+inline void SqRandom::setSeed(uint32_t seed) {
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i += 2) {
+        x += 0x9e3779b97f4a7c15ull;
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        z = z ^ (z >> 31);
+        state[i] = uint32_t(z);
+        state[i + 1] = uint32_t(z >> 32);
+    }
+    // all zero would get stuck there
+    assert(state[0] || state[1] || state[2] || state[3]);
+}
+
+inline uint32_t SqRandom::next() {
+    const uint32_t result = rotl(state[1] * 5, 7) * 9;
+    const uint32_t t = state[1] << 9;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 11);
+    return result;
+}
+
+// Multiply and take the top, throwing out the few results that would favor small numbers.
+inline uint32_t SqRandom::below(uint32_t n) {
+    assert(n > 0);
+    uint64_t m = uint64_t(next()) * n;
+    uint32_t low = uint32_t(m);
+    if (low < n) {
+        const uint32_t threshold = uint32_t(0 - n) % n;
+        while (low < threshold) {
+            m = uint64_t(next()) * n;
+            low = uint32_t(m);
+        }
+    }
+    return uint32_t(m >> 32);
+}
+
+template <typename T>
+inline void SqRandom::shuffle(T* data, int size) {
+    for (int i = size - 1; i > 0; --i) {
+        const int j = int(below(uint32_t(i + 1)));
+        const T temp = data[i];
+        data[i] = data[j];
+        data[j] = temp;
+    }
+}
+
+// Swapping a bad first with a random other place lands on each allowed order
+// from exactly one shuffle that was already allowed and one that wasn't, so they stay even.
+template <typename T>
+inline void SqRandom::shuffle(T* data, int size, T notFirst) {
+    shuffle(data, size);
+    if (size > 1 && data[0] == notFirst) {
+        const int j = 1 + int(below(uint32_t(size - 1)));
+        data[0] = data[j];
+        data[j] = notFirst;
+    }
+}
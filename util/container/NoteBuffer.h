@@ -2,8 +2,17 @@
 
 #include "SqLog.h"
 #include <assert.h>
+#include <stdint.h>
+#include <algorithm>
 #include <functional>
 
+/**
+ * The notes an arpeggiator is holding, in the order they came in.
+ *
+ * Notes live in a fixed pool of slots, linked together in the order played.
+ * Each note is also on a list of the notes for its channel, so push,
+ * evicting the oldest note, and removing by channel are all O(1).
+ */
 class NoteBuffer {
 public:
     NoteBuffer(int cap);
@@ -14,15 +23,27 @@ public:
     int getCapacity() const {
         return curCapacity;
     }
-    static const int maxCapacity{32};
+    static const int maxCapacity{128};
+    static const int defaultCapacity{32};  // what setCapacity(0) gives
     int size() const { return siz; }
     bool empty() const { return siz == 0; }
 
+    /**
+     * Goes up by one on every change. Cheaper to poll than
+     * registering a callback.
+     */
+    unsigned getChangeCount() const { return changeCount; }
+
     void push_back(float cv1, float cv2, int channel);
     void removeForChannel(int channel);
     void removeAtIndex(int index);
     void setHold(bool);
 
+    /**
+     * Removes every note, even in hold mode.
+     */
+    void clear();
+
     class Data {
     public:
         Data(float p1, float v1, int ch) : channel(ch), cv1(p1), cv2(v1) {}
@@ -32,31 +53,146 @@ public:
         float cv2 = 0;
     };
 
-    const Data* begin() const;
-    const Data* end() const;
+    /**
+     * Remove the notes on channels [firstChannel, firstChannel + numChannels),
+     * then append count notes, as one change. Listeners are only called once.
+     * In hold mode nothing is removed, so new notes add on to the held ones.
+     */
+    void replaceChannels(int firstChannel, int numChannels, const Data* notes, int count);
+
+    /**
+     * Same as calling removeForChannel for each of removeChannels, then push_back
+     * for each of notes, but listeners are only called once.
+     */
+    void update(const int* removeChannels, int numRemove, const Data* notes, int count);
+
+    /**
+     * Walks the notes oldest to newest.
+     * Moving by more than one is O(n), it's there for the tests.
+     */
+    class const_iterator {
+    public:
+        const Data& operator*() const { return nb->pool[slot].data; }
+        const Data* operator->() const { return &nb->pool[slot].data; }
+        const_iterator& operator++() {
+            slot = nb->pool[slot].next;
+            return *this;
+        }
+        const_iterator operator+(int n) const {
+            const_iterator ret = *this;
+            for (int i = 0; i < n; ++i) {
+                ++ret;
+            }
+            return ret;
+        }
+        int operator-(const_iterator other) const {
+            int ret = 0;
+            for (; other != *this; ++other) {
+                ++ret;
+            }
+            return ret;
+        }
+        bool operator==(const const_iterator& other) const { return slot == other.slot; }
+        bool operator!=(const const_iterator& other) const { return slot != other.slot; }
+
+    private:
+        friend class NoteBuffer;
+        const_iterator(const NoteBuffer* b, int s) : nb(b), slot(s) {}
+        const NoteBuffer* nb;
+        int slot;
+    };
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    /**
+     * O(n). Use an iterator to look at all of them.
+     */
     const Data& at(int index) const;
 
+    /**
+     * The notes sorted by cv1, then cv2. O(1).
+     * The sort order is kept up to date as notes come and go.
+     */
+    const Data& getSorted(int index) const {
+        assert(index >= 0 && index < siz);
+        return pool[sortedSlots[index]].data;
+    }
+
     using RejectFunction = std::function<bool(int index)>;
 
 private:
     int siz = 0;
     int curCapacity = 1;
     bool holdMode = false;
+    unsigned changeCount = 0;
     callback cb;
 
     void callbackMaybe() {
+        ++changeCount;
         if (cb) {
             cb(this);
         }
     }
 
-    Data data[maxCapacity + 2];
+    static const int none = -1;
+
+    // channels below this get their own list. Others are found by searching.
+    static const int numIndexedChannels = 64;
+
+    class Node {
+    public:
+        Data data;
+        int16_t prev = none;
+        int16_t next = none;
+        int16_t prevInChannel = none;
+        int16_t nextInChannel = none;
+    };
+
+    Node pool[maxCapacity];
+    int16_t head = none;  // oldest
+    int16_t tail = none;  // newest
+    int16_t freeList = none;
+    int16_t channelHead[numIndexedChannels];
+    int16_t channelTail[numIndexedChannels];
+
+    // slot of every note, in pitch order
+    int16_t sortedSlots[maxCapacity];
+
+    static bool lessThan(const Data& a, const Data& b) {
+        return (a.cv1 < b.cv1) || ((a.cv1 == b.cv1) && (a.cv2 < b.cv2));
+    }
+    void addToSorted(int slot);
+    void removeFromSorted(int slot);
+
+    static bool isIndexed(int channel) {
+        return (channel >= 0) && (channel < numIndexedChannels);
+    }
+
     void removeAll();
+    void append(const Data&);
+    void appendAll(const Data* notes, int count);
+    void unlink(int slot);
+    void removeOldest() { unlink(head); }
+    int findChannel(int channel) const;
+    int slotAtIndex(int index) const;
 };
 
+inline NoteBuffer::const_iterator operator+(int n, NoteBuffer::const_iterator it) {
+    return it + n;
+}
+
 inline NoteBuffer::NoteBuffer(int cap) {
     assert(cap > 0);
-    curCapacity = cap;
+    curCapacity = std::min(cap, maxCapacity);
+    for (int i = 0; i < numIndexedChannels; ++i) {
+        channelHead[i] = none;
+        channelTail[i] = none;
+    }
+    for (int i = 0; i < maxCapacity; ++i) {
+        pool[i].next = (i + 1 < maxCapacity) ? i + 1 : none;
+    }
+    freeList = 0;
 }
 
 inline void NoteBuffer::setHold(bool h) {
@@ -73,21 +209,15 @@ inline void NoteBuffer::setHold(bool h) {
 
 inline void NoteBuffer::setCapacity(int size) {
     if (size == 0) {
-        size = maxCapacity;
+        size = defaultCapacity;
     }
     size = std::min(size, maxCapacity);
     if (size != curCapacity) {
         curCapacity = size;
-      //  siz = std::min(siz, size);      // current size can't be more than we hold
-
-        // if we are shrinking
-        if (siz > size) {
-            const int moveOffset = siz - size;
-            assert(moveOffset > 0);
-            for (int i = 0; i < size; ++i) {
-                data[i] = data[i + moveOffset];
-            }
-            siz = size;
+
+        // if we are shrinking, the oldest ones go
+        while (siz > size) {
+            removeOldest();
         }
 
         callbackMaybe();
@@ -98,31 +228,201 @@ inline void NoteBuffer::onChange(callback callb) {
     cb = callb;
 }
 
-inline void NoteBuffer::push_back(float v1, float v2, int channel) {
-    // SQINFO("nb push, siz=%d, cap=%d this=%p", siz, curCapacity, this);
+inline void NoteBuffer::append(const Data& d) {
     if (siz >= curCapacity) {
-        for (int i = 0; i < siz - 1; ++i) {
-            data[i] = data[i + 1];
+        removeOldest();
+    }
+    assert(freeList != none);
+    const int16_t slot = freeList;
+    Node& node = pool[slot];
+    freeList = node.next;
+
+    node.data = d;
+    node.prev = tail;
+    node.next = none;
+    if (tail != none) {
+        pool[tail].next = slot;
+    } else {
+        head = slot;
+    }
+    tail = slot;
+
+    addToSorted(slot);
+
+    node.nextInChannel = none;
+    node.prevInChannel = none;
+    if (isIndexed(d.channel)) {
+        const int channel = d.channel;
+        node.prevInChannel = channelTail[channel];
+        if (channelTail[channel] != none) {
+            pool[channelTail[channel]].nextInChannel = slot;
+        } else {
+            channelHead[channel] = slot;
         }
-        data[siz - 1] = Data(v1, v2, channel);
+        channelTail[channel] = slot;
+    }
+    ++siz;
+}
+
+inline void NoteBuffer::unlink(int slot) {
+    assert(slot != none);
+    removeFromSorted(slot);
+    Node& node = pool[slot];
+    if (node.prev != none) {
+        pool[node.prev].next = node.next;
+    } else {
+        head = node.next;
+    }
+    if (node.next != none) {
+        pool[node.next].prev = node.prev;
     } else {
-        data[siz] = Data(v1, v2, channel);
-        siz++;
+        tail = node.prev;
+    }
+
+    if (isIndexed(node.data.channel)) {
+        const int channel = node.data.channel;
+        if (node.prevInChannel != none) {
+            pool[node.prevInChannel].nextInChannel = node.nextInChannel;
+        } else {
+            channelHead[channel] = node.nextInChannel;
+        }
+        if (node.nextInChannel != none) {
+            pool[node.nextInChannel].prevInChannel = node.prevInChannel;
+        } else {
+            channelTail[channel] = node.prevInChannel;
+        }
+    }
+
+    node.next = freeList;
+    freeList = int16_t(slot);
+    --siz;
+}
+
+// Binary search for the spot, then move the rest up one.
+// siz doesn't include slot yet.
+inline void NoteBuffer::addToSorted(int slot) {
+    const Data& d = pool[slot].data;
+    int lo = 0;
+    int hi = siz;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (lessThan(d, pool[sortedSlots[mid]].data)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
     }
+    std::copy_backward(sortedSlots + lo, sortedSlots + siz, sortedSlots + siz + 1);
+    sortedSlots[lo] = int16_t(slot);
+}
+
+inline void NoteBuffer::removeFromSorted(int slot) {
+    const Data& d = pool[slot].data;
+    int lo = 0;
+    int hi = siz;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (lessThan(pool[sortedSlots[mid]].data, d)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // might be other notes with the same value
+    while ((lo < siz) && (sortedSlots[lo] != slot)) {
+        ++lo;
+    }
+    if (lo == siz) {
+        // can only happen if the cv doesn't compare, like NaN
+        lo = int(std::find(sortedSlots, sortedSlots + siz, slot) - sortedSlots);
+    }
+    assert(lo < siz);
+    std::copy(sortedSlots + lo + 1, sortedSlots + siz, sortedSlots + lo);
+}
+
+inline void NoteBuffer::push_back(float v1, float v2, int channel) {
+    // SQINFO("nb push, siz=%d, cap=%d this=%p", siz, curCapacity, this);
+    append(Data(v1, v2, channel));
     callbackMaybe();
 }
 
-inline const NoteBuffer::Data* NoteBuffer::begin() const {
-    return data;
+inline void NoteBuffer::replaceChannels(int firstChannel, int numChannels, const Data* notes, int count) {
+    assert(count <= maxCapacity);
+    if (!holdMode) {
+        for (int channel = firstChannel; channel < firstChannel + numChannels; ++channel) {
+            for (int slot = findChannel(channel); slot != none; slot = findChannel(channel)) {
+                unlink(slot);
+            }
+        }
+    }
+
+    appendAll(notes, count);
+    callbackMaybe();
 }
 
-inline const NoteBuffer::Data* NoteBuffer::end() const {
-    return data + size();
+inline void NoteBuffer::update(const int* removeChannels, int numRemove, const Data* notes, int count) {
+    assert(count <= maxCapacity);
+    if (!holdMode) {
+        for (int i = 0; i < numRemove; ++i) {
+            const int slot = findChannel(removeChannels[i]);
+            if (slot != none) {
+                unlink(slot);
+            }
+        }
+    }
+    appendAll(notes, count);
+    callbackMaybe();
 }
 
-inline  const NoteBuffer::Data& NoteBuffer::at(int index) const {
-    assert(index < siz);
-    return data[index];
+inline void NoteBuffer::appendAll(const Data* notes, int count) {
+    // same as push_back: when full, the oldest notes fall off the front
+    const int skip = std::max(0, count - curCapacity);
+    for (int i = skip; i < count; ++i) {
+        append(notes[i]);
+    }
+}
+
+inline NoteBuffer::const_iterator NoteBuffer::begin() const {
+    return const_iterator(this, head);
+}
+
+inline NoteBuffer::const_iterator NoteBuffer::end() const {
+    return const_iterator(this, none);
+}
+
+inline int NoteBuffer::slotAtIndex(int index) const {
+    assert(index >= 0 && index < siz);
+    int slot = none;
+    // walk from whichever end is closer
+    if (index < siz / 2) {
+        slot = head;
+        for (int i = 0; i < index; ++i) {
+            slot = pool[slot].next;
+        }
+    } else {
+        slot = tail;
+        for (int i = siz - 1; i > index; --i) {
+            slot = pool[slot].prev;
+        }
+    }
+    return slot;
+}
+
+inline const NoteBuffer::Data& NoteBuffer::at(int index) const {
+    return pool[slotAtIndex(index)].data;
+}
+
+// oldest note on channel, or none
+inline int NoteBuffer::findChannel(int channel) const {
+    if (isIndexed(channel)) {
+        return channelHead[channel];
+    }
+    for (int slot = head; slot != none; slot = pool[slot].next) {
+        if (pool[slot].data.channel == channel) {
+            return slot;
+        }
+    }
+    return none;
 }
 
 inline void NoteBuffer::removeForChannel(int channel) {
@@ -131,26 +431,30 @@ inline void NoteBuffer::removeForChannel(int channel) {
         // printf("remove does nothing, hold on\n");
         return;
     }
-    for (int i = 0; i < siz; ++i) {
-        // printf("remove i=%d, data.ch=%d, p=%f\n", i, data[i].channel, data[i].cv);
-        if (channel == data[i].channel) {           
-            return removeAtIndex(i);
-        }
+    const int slot = findChannel(channel);
+    if (slot != none) {
+        unlink(slot);
+        callbackMaybe();
     }
 }
 
 inline void NoteBuffer::removeAtIndex(int index) {
-    for (int i = index; i < (siz - 1); ++i) {
-        data[i] = data[i + 1];
-    }
-    if (siz) {
-        --siz;
+    if (index < siz) {
+        unlink(slotAtIndex(index));
     }
     callbackMaybe();
 }
 
+inline void NoteBuffer::clear() {
+    if (!empty()) {
+        removeAll();
+    }
+}
+
 inline void NoteBuffer::removeAll() {
     // SQINFO("nb remove all");
-    siz = 0;
+    while (head != none) {
+        removeOldest();
+    }
     callbackMaybe();
 }
@@ -78,15 +78,18 @@ ScaleNote Scale::makeScaleNote(int offset) const {
 }
 
 std::vector<std::string> Scale::getShortScaleLabels(bool justDiatonic) {
-    assert(justDiatonic);
-    return {
-        "Major",
-        "Dorian",
-        "Phrygian",
-        "Lydian",
-        "Mixo.",
-        "Minor",
-        "Locrian"};
+    if (justDiatonic)
+        return {
+            "Major",
+            "Dorian",
+            "Phrygian",
+            "Lydian",
+            "Mixo.",
+            "Minor",
+            "Locrian"};
+    else
+        return {"Major", "Dorian", "Phrygian", "Lydian", "Mixo.", "Minor", "Locrian",
+                "Min. Pent.", "Harm. Min.", "Dim.", "Dom. Dim.", "Whole"};
 }
 
 std::vector<std::string>
@@ -217,6 +220,15 @@ int Scale::degreeToSemitone(int degree) const {
     return pitches[degreeIndex];
 }
 
+int Scale::numDegrees() const {
+    const int* pitches = getNormalizedScalePitches();
+    int ret = 0;
+    while (pitches[ret] >= 0) {
+        ++ret;
+    }
+    return ret;
+}
+
 const int* Scale::getNormalizedScalePitches() const {
     assert(wasSet);
     switch (scale) {
@@ -415,7 +427,10 @@ const MidiNote flatsInBass[12] = {
 
 Scale::ScoreInfo Scale::getScoreInfo() const {
     Scale::ScoreInfo ret;
-    assert(int(scale) <= int(Scales::Locrian));
+    if (int(scale) > int(Scales::Locrian)) {
+        // no key signature for the others, just draw them in C
+        return ret;
+    }
 
     const int basePitch = getRelativeMajor().get();
     assert(basePitch >= 0);
@@ -41,6 +41,12 @@ public:
      */
     int degreeToSemitone(int degree) const;
 
+    /**
+     * @return int is the number of notes in the current scale.
+     *      7 for the diatonic modes, 5 for pentatonic, etc.
+     */
+    int numDegrees() const;
+
     /**
      * @brief quantize a pitch to a scale
      *
@@ -80,7 +86,7 @@ public:
 
     /**
      * @brief Get the Score Info object for current scale
-     * Only works for the diatonic modes.
+     * Only the diatonic modes have a key signature, other scales get an empty one.
      * 
      * @return ScoreInfo 
      */
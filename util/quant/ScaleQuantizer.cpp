@@ -26,6 +26,25 @@ ScaleQuantizerPtr ScaleQuantizer::makeTestCMaj() {
 }
 
 MidiNote ScaleQuantizer::run(float voltage) {
+    MidiNote quantizedMn = quantize(voltage);
+
+    const float hysteresisVolts = options->hysteresis / 12.f;
+    if (haveLastNote && (hysteresisVolts > 0) && (quantizedMn.get() != lastQuantizedNote.get())) {
+        // Pull the input back toward the last note. If that lands on the last note
+        // we are still inside the hysteresis band, so don't move.
+        const float pulledBack = (quantizedMn.get() > lastQuantizedNote.get()) ? voltage - hysteresisVolts : voltage + hysteresisVolts;
+        if (quantize(pulledBack).get() == lastQuantizedNote.get()) {
+            quantizedMn = lastQuantizedNote;
+        }
+    }
+
+    lastValue = voltage;
+    lastQuantizedNote = quantizedMn;
+    haveLastNote = true;
+    return quantizedMn;
+}
+
+MidiNote ScaleQuantizer::quantize(float voltage) const {
     FloatNote fn(voltage);
     MidiNote mn;
     NoteConvert::f2m(mn, fn);
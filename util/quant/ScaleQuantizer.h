@@ -43,7 +43,7 @@ using ScaleQuantizerPtr = std::shared_ptr<ScaleQuantizer>;
 
 /**
  * needs:
- *      hysteresis
+ *      hysteresis (done)
  *      chromatic option?
  *      selection for equal interval?
  *      selection for rounding of non scale tones?
@@ -56,6 +56,9 @@ public:
     class Options {
     public:
         ScalePtr scale;
+
+        // in semitones. The input must go this far past the point half way
+        // between two scale notes before the output will change.
         float   hysteresis = 0;
     };
     using ConstOptionsPtr = std::shared_ptr<const Options>;
@@ -70,5 +73,8 @@ public:
 private:
     float lastValue = 0;
     MidiNote lastQuantizedNote;
+    bool haveLastNote = false;
     ConstOptionsPtr options;
+
+    MidiNote quantize(float) const;
 };
\ No newline at end of file